@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <limits>
 #include <utility>
 #include <vector>
 #include <array>
@@ -10,6 +11,9 @@
 #include <boost/range/begin.hpp>
 #include <boost/range/end.hpp>
 
+#include "fuzzy_search/memory.h"
+#include "fuzzy_search/stats.h"
+
 template <typename RandomAccessIterator1, typename RandomAccessIterator2>
 std::pair<RandomAccessIterator1, RandomAccessIterator1>
 bitap_fuzzy_bitwise_search_new(RandomAccessIterator1 corpus_begin, RandomAccessIterator1 corpus_end,
@@ -27,28 +31,33 @@ bitap_fuzzy_bitwise_search_new(RandomAccessIterator1 corpus_begin, RandomAccessI
     //TODO: check sizeof(long) which is platoform-dependent
     assert(m <= 31);
 
-    std::array<unsigned long, std::numeric_limits<char>::max() + 1> pattern_mask;
+    // indexed by unsigned char, plain char is signed on most targets
+    std::array<unsigned long, std::numeric_limits<unsigned char>::max() + 1> pattern_mask;
     pattern_mask.fill(~0);
     for (size_t i = 0; i < m; ++i)
     {
-        pattern_mask[pattern_begin[i]] &= ~(1UL << i);
+        pattern_mask[static_cast<unsigned char>(pattern_begin[i])] &= ~(1UL << i);
     }
 
-    std::vector<unsigned long> R((k + 1) * sizeof(void*), ~1);
+    fuzzy::ArenaScope scope;
+    std::vector<unsigned long, fuzzy::ResourceAllocator<unsigned long>> R(
+            (k + 1) * sizeof(void*), ~1, fuzzy::ResourceAllocator<unsigned long>(fuzzy::query_resource()));
     std::pair<RandomAccessIterator1, RandomAccessIterator1> result(corpus_end, corpus_end);
-    for (RandomAccessIterator1 it = corpus_begin; it != corpus_end; ++it)
+    RandomAccessIterator1 it;
+    for (it = corpus_begin; it != corpus_end; ++it)
     {
         /* Update the bit arrays */
         unsigned long old_Rd1 = R[0];
 
-        R[0] |= pattern_mask[*it];
+        const unsigned long mask = pattern_mask[static_cast<unsigned char>(*it)];
+        R[0] |= mask;
         R[0] <<= 1;
 
         for (size_t d = 1; d <= k; ++d)
         {
             unsigned long tmp = R[d];
             /* Substitution is all we care about */
-            R[d] = (old_Rd1 & (R[d] | pattern_mask[*it])) << 1;
+            R[d] = (old_Rd1 & (R[d] | mask)) << 1;
             old_Rd1 = tmp;
         }
 
@@ -56,10 +65,13 @@ bitap_fuzzy_bitwise_search_new(RandomAccessIterator1 corpus_begin, RandomAccessI
         {
             result.first = (it - m) + 1;
             result.second = result.first + m;
+            ++it;
             break;
         }
     }
 
+    FUZZY_STATS_ADD(bytes_scanned, it - corpus_begin);
+
     return result;
 }
 
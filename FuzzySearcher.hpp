@@ -0,0 +1,601 @@
+#ifndef FUZZYSEARCH_FUZZYSEARCHER_HPP
+#define FUZZYSEARCH_FUZZYSEARCHER_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Randl_fuzzy_search.hpp"
+#include "Bitap.hpp"
+#include "libflasm.h"
+#include "fuzzy_search/memory.h"
+
+namespace fuzzy
+{
+
+enum class Metric
+{
+    Hamming,
+    Levenshtein
+};
+
+enum class Engine
+{
+    Auto,
+    Bitap,            // bitap_fuzzy_bitwise_search_new, substitutions only
+    Randl,            // fuzzy_search, reduced alphabet q-gram filter
+    Flasm,            // libflasm::flasm_hd / flasm_ed with the whole pattern as factor
+    HammingSimple,    // seqan::Pattern<.., HammingSimple>
+    HammingShiftAdd,  // seqan::Pattern<.., HammingShiftAdd>
+    Myers,            // seqan::Pattern<.., Myers<> >
+    Abndm,            // seqan::Pattern<.., AbndmAlgo>
+    Pex,              // seqan::Pattern<.., PexPipelined>
+    Horspool          // seqan::Pattern<.., Horspool>, exact search only
+};
+
+/**
+ * A single occurrence of the pattern: end is one past the last text character
+ * of the occurrence and errors its distance to the pattern under the metric
+ */
+struct Match
+{
+    size_t end;
+    size_t errors;
+};
+
+/**
+ * The engine picked for a query and why, so callers can log or override it
+ */
+struct Plan
+{
+    Engine engine;
+    bool supported;
+    const char * reason;
+};
+
+inline const char * engine_name(Engine engine)
+{
+    switch (engine)
+    {
+        case Engine::Auto: return "auto";
+        case Engine::Bitap: return "bitap";
+        case Engine::Randl: return "randl";
+        case Engine::Flasm: return "flasm";
+        case Engine::HammingSimple: return "seqan_hamming";
+        case Engine::HammingShiftAdd: return "seqan_shiftadd";
+        case Engine::Myers: return "seqan_myers";
+        case Engine::Abndm: return "seqan_abndm";
+        case Engine::Pex: return "seqan_pex";
+        case Engine::Horspool: return "seqan_horspool";
+    }
+    return "unknown";
+}
+
+namespace detail
+{
+
+// Bitap and ABNDM index their tables with plain chars
+inline bool seven_bit(const char * s, size_t n)
+{
+    return std::find_if(s, s + n, [](char c) { return static_cast<unsigned char>(c) > 127; }) == s + n;
+}
+
+inline bool seven_bit(const std::string & s)
+{
+    return seven_bit(s.data(), s.size());
+}
+
+// the mismatch rate of random text, which decides how early HammingSimple leaves a window
+inline size_t distinct_symbols(const std::string & s)
+{
+    std::vector<bool> seen(256, false);
+    size_t symbols = 0;
+    for (unsigned char c : s)
+    {
+        symbols += !seen[c];
+        seen[c] = true;
+    }
+    return symbols;
+}
+
+// fuzzy_search reads q-grams of length 6, which must fit into the shortest occurrence
+inline bool randl_supported(const std::string & pattern, size_t k, Metric metric)
+{
+    return pattern.size() >= 6 + (metric == Metric::Levenshtein ? k : 0);
+}
+
+inline size_t hamming(const char * text, size_t begin, const std::string & pattern)
+{
+    size_t errors = 0;
+    for (size_t i = 0; i < pattern.size(); ++i)
+    {
+        errors += text[begin + i] != pattern[i];
+    }
+    return errors;
+}
+
+template <typename TText, typename TPattern>
+inline void collect(TText & text, TPattern & pattern, int score, std::vector<Match> & matches)
+{
+    seqan::Finder<TText> finder(text);
+    while (seqan::find(finder, pattern, score))
+    {
+        matches.push_back({static_cast<size_t>(seqan::endPosition(finder)),
+                           static_cast<size_t>(-seqan::getScore(pattern))});
+    }
+}
+
+template <typename TText, typename TPattern>
+inline void collect(TText & text, TPattern & pattern, std::vector<Match> & matches)
+{
+    seqan::Finder<TText> finder(text);
+    while (seqan::find(finder, pattern))
+    {
+        matches.push_back({static_cast<size_t>(seqan::endPosition(finder)),
+                           static_cast<size_t>(-seqan::getScore(pattern))});
+    }
+}
+
+}  // namespace detail
+
+/**
+ * One entry point for all fuzzy search engines of the library. Every engine
+ * reports all occurrences with at most k errors as Match values sorted by end
+ * position. With Engine::Auto the engine is chosen from the shape of the query
+ * (see plan()); any other engine forces that choice.
+ *
+ * With a memory budget set, the engines that allocate in proportion to the
+ * text (Randl, Flasm and the copy of the text the SeqAn filters search) run
+ * within it, see fuzzy_search/memory.h. The returned matches are not charged.
+ */
+class FuzzySearcher
+{
+public:
+    explicit FuzzySearcher(Metric metric = Metric::Levenshtein, Engine engine = Engine::Auto)
+        : metric_(metric), engine_(engine)
+    {}
+
+    Metric metric() const { return metric_; }
+
+    Engine engine() const { return engine_; }
+
+    void set_engine(Engine engine) { engine_ = engine; }
+
+    MemoryBudget * memory_budget() const { return budget_; }
+
+    // the budget is used by every later search until it is reset to nullptr
+    void set_memory_budget(MemoryBudget * budget) { budget_ = budget; }
+
+    size_t threads() const { return threads_; }
+
+    /**
+     * The threads a query may use, 0 for one per hardware thread. Pex verifies
+     * its candidate windows on the extra ones while it filters the text.
+     */
+    void set_threads(size_t threads) { threads_ = threads; }
+
+    /**
+     * Decides which engine runs a query. The automatic choice follows the
+     * measurements of FuzzySearchBenchmark:
+     * - exact search under either metric runs Horspool, which compares four
+     *   pattern characters against 32 text positions at a time with AVX2
+     * - small k/m ratios (8k <= m, k + 1 < m) are filtered by ABNDM on 7-bit
+     *   texts and by Pex's pigeonhole split otherwise
+     * - remaining Levenshtein queries run Myers' bit-parallel algorithm
+     * - Hamming queries up to 255 characters run the FLASM diagonal counters
+     *   when the AVX2 or AVX-512 kernel is available
+     * - otherwise Hamming queries of 17..31 characters with 16k < m run
+     *   Bitap, other ones below 64 characters the SSE2 FLASM counters,
+     *   longer ones with 8k < m the SeqAn shift-add counters up to 128
+     *   characters over at most 4 symbols (e.g. DNA) and the SeqAn
+     *   early-exit scanner otherwise
+     * The filters fall back to Myers when a memory budget is set and their
+     * copy of the text does not fit in it.
+     * The Randl reduced-alphabet filter is never chosen automatically: every
+     * call enumerates all q-grams of length 6 over up to 16 symbols, so it
+     * only pays off when forced for small alphabets or very large texts.
+     */
+    Plan plan(const std::string & text, const std::string & pattern, size_t k) const
+    {
+        return plan(text.data(), text.size(), pattern, k);
+    }
+
+    /**
+     * Same as above for a text that is not held in a std::string, such as a
+     * memory-mapped file
+     */
+    Plan plan(const char * text, size_t n, const std::string & pattern, size_t k) const
+    {
+        const size_t m = pattern.size();
+
+        switch (engine_)
+        {
+            case Engine::Auto: break;
+            case Engine::Bitap:
+                if (metric_ != Metric::Hamming)
+                    return {engine_, false, "bitap only supports Hamming distance"};
+                if (m > 31)
+                    return {engine_, false, "bitap needs patterns of at most 31 characters"};
+                return {engine_, true, "forced"};
+            case Engine::Randl:
+                if (!detail::randl_supported(pattern, k, metric_))
+                    return {engine_, false, "randl needs m >= 6 for Hamming and m >= 6 + k for Levenshtein distance"};
+                return {engine_, true, "forced"};
+            case Engine::Abndm:
+                if (metric_ != Metric::Levenshtein)
+                    return {engine_, false, "abndm only supports Levenshtein distance"};
+                // the filter does not terminate on patterns of k + 1 characters
+                if (m <= k + 1)
+                    return {engine_, false, "abndm needs at least two more pattern characters than errors"};
+                if (!detail::seven_bit(text, n) || !detail::seven_bit(pattern))
+                    return {engine_, false, "abndm needs 7-bit characters"};
+                return {engine_, true, "forced"};
+            case Engine::Pex:
+                if (metric_ != Metric::Levenshtein)
+                    return {engine_, false, "pex only supports Levenshtein distance"};
+                if (m <= k)
+                    return {engine_, false, "pex needs more pattern characters than errors"};
+                return {engine_, true, "forced"};
+            case Engine::Myers:
+                if (metric_ != Metric::Levenshtein)
+                    return {engine_, false, "myers only supports Levenshtein distance"};
+                return {engine_, true, "forced"};
+            case Engine::HammingSimple:
+                if (metric_ != Metric::Hamming)
+                    return {engine_, false, "seqan_hamming only supports Hamming distance"};
+                return {engine_, true, "forced"};
+            case Engine::HammingShiftAdd:
+                if (metric_ != Metric::Hamming)
+                    return {engine_, false, "seqan_shiftadd only supports Hamming distance"};
+                return {engine_, true, "forced"};
+            case Engine::Flasm:
+                return {engine_, true, "forced"};
+            case Engine::Horspool:
+                if (k != 0)
+                    return {engine_, false, "horspool only supports exact search"};
+                return {engine_, true, "forced"};
+        }
+
+        if (m == 0 || m > n)
+        {
+            return {Engine::Myers, true, "empty search"};
+        }
+
+        if (k == 0)
+        {
+            return {Engine::Horspool, true, "exact search: SIMD character probes"};
+        }
+
+        if (metric_ == Metric::Levenshtein)
+        {
+            if (8 * k <= m && m > k + 1)
+            {
+                if (budget_ != nullptr && !budget_->fits(n))
+                    return {Engine::Myers, true, "small k/m ratio, text copy exceeds the memory budget: bit-parallel DP"};
+                if (detail::seven_bit(pattern) && detail::seven_bit(text, n))
+                    return {Engine::Abndm, true, "small k/m ratio, 7-bit text: backward DAWG filter"};
+                return {Engine::Pex, true, "small k/m ratio: pigeonhole filter"};
+            }
+            return {Engine::Myers, true, "large k/m ratio: bit-parallel DP"};
+        }
+
+        // with 32 or 64 byte lanes the FLASM counters beat every scalar engine up to their byte limit
+        const bool wide_simd = std::strcmp(libflasm::flasm_simd_kernel(), "avx2") == 0 ||
+                               std::strcmp(libflasm::flasm_simd_kernel(), "avx512") == 0;
+        if (wide_simd && m <= 255)
+        {
+            return {Engine::Flasm, true, "AVX2/AVX-512 diagonal mismatch counters"};
+        }
+        if (m > 16 && m <= 31 && 16 * k < m)
+        {
+            return {Engine::Bitap, true, "pattern fits a machine word with few errors"};
+        }
+        if (m < 64)
+        {
+            return {Engine::Flasm, true, "SIMD diagonal mismatch counters"};
+        }
+        // over larger alphabets most windows mismatch within a few characters, which the early exit beats
+        if (8 * k < m && m <= 128 && detail::distinct_symbols(pattern) <= 4)
+        {
+            return {Engine::HammingShiftAdd, true, "long pattern with few errors, small alphabet: bit-parallel mismatch counters"};
+        }
+        if (8 * k < m)
+        {
+            return {Engine::HammingSimple, true, "long pattern with few errors: early-exit scan"};
+        }
+        return {Engine::Flasm, true, "long pattern with many errors: mismatch counters"};
+    }
+
+    /**
+     * Searches text for all occurrences of pattern with at most k errors.
+     * Throws std::invalid_argument if a forced engine cannot run the query
+     * and BudgetExceeded if it does not fit in the memory budget.
+     *
+     * @param used If not null, receives the plan that ran the query
+     */
+    std::vector<Match> search(const std::string & text, const std::string & pattern, size_t k,
+                              Plan * used = nullptr) const
+    {
+        return search(text.data(), text.size(), pattern, k, used);
+    }
+
+    /**
+     * Same as above for the n characters at text, which are searched in place
+     * except by the SeqAn filters (Abndm, Pex)
+     */
+    std::vector<Match> search(const char * text, size_t n, const std::string & pattern, size_t k,
+                              Plan * used = nullptr) const
+    {
+        // the temporaries of the engines come from this thread's arena for the query
+        ArenaScope scope;
+        Plan p = plan(text, n, pattern, k);
+        if (used != nullptr)
+        {
+            *used = p;
+        }
+        if (!p.supported)
+        {
+            throw std::invalid_argument(std::string(engine_name(p.engine)) + ": " + p.reason);
+        }
+
+        std::vector<Match> matches;
+        if (pattern.empty() || pattern.size() > n)
+        {
+            return matches;
+        }
+
+        switch (p.engine)
+        {
+            case Engine::Bitap: bitap(text, n, pattern, k, matches); break;
+            case Engine::Randl: randl(text, n, pattern, k, matches); break;
+            case Engine::Flasm: flasm(text, n, pattern, k, matches); break;
+            default: seqan_engine(p.engine, text, n, pattern, k, matches); break;
+        }
+
+        std::sort(matches.begin(), matches.end(), [](const Match & a, const Match & b) { return a.end < b.end; });
+        return matches;
+    }
+
+    /**
+     * Searches text for all occurrences of each of patterns with at most k
+     * errors and returns their matches in the order of patterns.
+     *
+     * Levenshtein patterns that the automatic plan (or a forced Pex) would
+     * send to a filter are searched together in one pass of the MultiPex
+     * dictionary filter, the others one by one as by search(), so many
+     * patterns do not cost a pass over the text each.
+     */
+    std::vector<std::vector<Match>> search(const std::string & text, const std::vector<std::string> & patterns,
+                                           size_t k) const
+    {
+        return search(text.data(), text.size(), patterns, k);
+    }
+
+    // Same as above for the n characters at text
+    std::vector<std::vector<Match>> search(const char * text, size_t n, const std::vector<std::string> & patterns,
+                                           size_t k) const
+    {
+        std::vector<std::vector<Match>> matches(patterns.size());
+        std::vector<size_t> pooled;
+        if (metric_ == Metric::Levenshtein && (engine_ == Engine::Auto || engine_ == Engine::Pex) &&
+            (budget_ == nullptr || budget_->fits(n)))
+        {
+            for (size_t i = 0; i < patterns.size(); ++i)
+            {
+                const size_t m = patterns[i].size();
+                if (m > k && m <= n && (engine_ == Engine::Pex || 8 * k <= m))
+                {
+                    pooled.push_back(i);
+                }
+            }
+        }
+        if (!pooled.empty())
+        {
+            dictionary(text, n, patterns, pooled, k, matches);
+        }
+
+        size_t next = 0;
+        for (size_t i = 0; i < patterns.size(); ++i)
+        {
+            if (next < pooled.size() && pooled[next] == i)
+            {
+                ++next;
+                continue;
+            }
+            matches[i] = search(text, n, patterns[i], k);
+        }
+        return matches;
+    }
+
+private:
+    void bitap(const char * text, size_t n, const std::string & pattern, size_t k,
+               std::vector<Match> & matches) const
+    {
+        const char * it = text;
+        while (true)
+        {
+            auto result = bitap_fuzzy_bitwise_search_new(it, text + n, pattern.begin(), pattern.end(), k);
+            if (result.first == result.second)
+            {
+                return;
+            }
+            size_t begin = result.first - text;
+            matches.push_back({begin + pattern.size(), detail::hamming(text, begin, pattern)});
+            it = result.first + 1;
+        }
+    }
+
+    void randl(const char * text, size_t length, const std::string & pattern, size_t k,
+               std::vector<Match> & matches) const
+    {
+        const char * first = text;
+        const char * last = first + length;
+        const ptrdiff_t n = length;
+        const ptrdiff_t m = pattern.size();
+        size_t last_end = 0;
+
+        ptrdiff_t from = 0;
+        while (from < n)
+        {
+            const bool mismatch = metric_ == Metric::Hamming;
+            const char * it = budget_ != nullptr
+                    ? fuzzy_search(first + from, last, pattern.begin(), pattern.end(), k, mismatch, *budget_)
+                    : fuzzy_search(first + from, last, pattern.begin(), pattern.end(), k, mismatch);
+            if (it == last)
+            {
+                return;
+            }
+
+            // fuzzy_search returns the leftmost occurrence under Hamming
+            // distance. Under Levenshtein distance it returns the start of
+            // the m + k characters ending with the leftmost occurrence end;
+            // Myers' algorithm over them reports that end and every later end
+            // of an occurrence starting there, which the next call (from the
+            // following character) would miss
+            ptrdiff_t begin = it - first;
+            if (metric_ == Metric::Hamming)
+            {
+                last_end = begin + m;
+                matches.push_back({last_end, detail::hamming(text, begin, pattern)});
+            }
+            else
+            {
+                std::string window(text + begin, std::min<ptrdiff_t>(m + k, n - begin));
+                seqan::CharString needle = pattern;
+                seqan::Pattern<seqan::CharString, seqan::Myers<> > myers(needle);
+                std::vector<Match> found;
+                detail::collect(window, myers, -static_cast<int>(k), found);
+                for (const Match & match : found)
+                {
+                    if (begin + match.end > last_end)
+                    {
+                        last_end = begin + match.end;
+                        matches.push_back({last_end, match.errors});
+                    }
+                }
+            }
+            from = begin + 1;
+        }
+    }
+
+    void flasm(const char * text, size_t n, const std::string & pattern, size_t k,
+               std::vector<Match> & matches) const
+    {
+        unsigned char * t = reinterpret_cast<unsigned char *>(const_cast<char *>(text));
+        unsigned char * x = reinterpret_cast<unsigned char *>(const_cast<char *>(pattern.data()));
+
+        libflasm::ResultTupleSet results;
+        if (budget_ != nullptr)
+        {
+            results = metric_ == Metric::Hamming
+                    ? libflasm::flasm_hd(t, n, x, pattern.size(), pattern.size(), k, true, *budget_)
+                    : libflasm::flasm_ed(t, n, x, pattern.size(), pattern.size(), k, true, *budget_);
+        }
+        else
+        {
+            results = metric_ == Metric::Hamming
+                    ? libflasm::flasm_hd(t, n, x, pattern.size(), pattern.size(), k, true)
+                    : libflasm::flasm_ed(t, n, x, pattern.size(), pattern.size(), k, true);
+        }
+
+        for (const libflasm::ResultTuple & result : results)
+        {
+            matches.push_back({result.pos_t + 1, result.error});
+        }
+    }
+
+    // one MultiPex pass for the patterns at the indices in pooled, their matches come sorted by end
+    void dictionary(const char * text, size_t n, const std::vector<std::string> & patterns,
+                    const std::vector<size_t> & pooled, size_t k, std::vector<std::vector<Match>> & matches) const
+    {
+        seqan::StringSet<seqan::CharString> needles;
+        for (size_t i : pooled)
+        {
+            seqan::appendValue(needles, seqan::CharString(patterns[i]));
+        }
+
+        BudgetCharge copy(budget_, n);
+        char * data = const_cast<char *>(text);
+        seqan::CharString haystack(libflasm::TextView(data, data + n));
+        seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::MultiPex<> > pattern(needles, -static_cast<int>(k));
+        seqan::Finder<seqan::CharString> finder(haystack);
+        while (seqan::find(finder, pattern))
+        {
+            matches[pooled[seqan::position(pattern)]].push_back({static_cast<size_t>(seqan::endPosition(finder)),
+                                                               static_cast<size_t>(-seqan::getScore(pattern))});
+        }
+    }
+
+    void seqan_engine(Engine engine, const char * text, size_t n, const std::string & pattern, size_t k,
+                      std::vector<Match> & matches) const
+    {
+        seqan::CharString needle = pattern;
+        const int score = -static_cast<int>(k);
+
+        // Myers, Horspool and the Hamming scanners search the text in place, the
+        // filters need a SeqAn string to take segments from
+        char * data = const_cast<char *>(text);
+        libflasm::TextView view(data, data + n);
+
+        switch (engine)
+        {
+            case Engine::HammingSimple:
+            {
+                seqan::Pattern<seqan::CharString, seqan::HammingSimple> hamming(needle);
+                detail::collect(view, hamming, score, matches);
+                break;
+            }
+            case Engine::HammingShiftAdd:
+            {
+                seqan::Pattern<seqan::CharString, seqan::HammingShiftAdd> shiftadd(needle);
+                detail::collect(view, shiftadd, score, matches);
+                break;
+            }
+            case Engine::Abndm:
+            {
+                BudgetCharge copy(budget_, n);
+                seqan::CharString haystack(view);
+                seqan::Pattern<seqan::CharString, seqan::AbndmAlgo> abndm(needle, score);
+                detail::collect(haystack, abndm, matches);
+                break;
+            }
+            case Engine::Horspool:
+            {
+                seqan::Pattern<seqan::CharString, seqan::Horspool> horspool(needle);
+                seqan::Finder<libflasm::TextView> finder(view);
+                while (seqan::find(finder, horspool))
+                {
+                    matches.push_back({static_cast<size_t>(seqan::endPosition(finder)), 0});
+                }
+                break;
+            }
+            case Engine::Pex:
+            {
+                BudgetCharge copy(budget_, n);
+                seqan::CharString haystack(view);
+                seqan::Pattern<seqan::CharString, seqan::PexPipelined> pex(needle, score);
+                seqan::setVerificationThreads(pex, static_cast<unsigned>(threads_));
+                detail::collect(haystack, pex, matches);
+                break;
+            }
+            default:
+            {
+                seqan::Pattern<seqan::CharString, seqan::Myers<> > myers(needle);
+                detail::collect(view, myers, score, matches);
+                break;
+            }
+        }
+    }
+
+    Metric metric_;
+    Engine engine_;
+    MemoryBudget * budget_ = nullptr;
+    size_t threads_ = 1;
+};
+
+}  // namespace fuzzy
+
+#endif  // FUZZYSEARCH_FUZZYSEARCHER_HPP
@@ -13,13 +13,20 @@
 #include <algorithm>
 #include <functional>
 #include <map>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
+#include "fuzzy_search/memory.h"
+#include "fuzzy_search/stats.h"
+
 /**
  * Helper function for preprocessing of data for search with Hamming difference
  * @tparam ForwardIt1
- * @tparam SearchedType
+ * @tparam Gram q-gram, a vector of SearchedType
+ * @tparam Set
+ * @tparam Table map from q-grams to values
+ * @tparam Distances
  * @param first
  * @param last
  * @param k number of allowed mistakes
@@ -31,18 +38,18 @@
  * @param Ds array of the lengthes of jumps for qgrams
  * @param D array to calculate distance between qgram and needle
  */
-template <class ForwardIt1, class SearchedType>
+template <class ForwardIt1, class Gram, class Set, class Table, class Distances>
 void preprocess_helper_hamming(ForwardIt1 first,
                                ForwardIt1 last,
                                size_t m,
                                size_t k,
                                size_t q,
                                size_t i,
-                               std::vector<SearchedType> &s,
-                               std::unordered_set<SearchedType> &S1,
-                               std::map<std::vector<SearchedType>, size_t> &M,
-                               std::map<std::vector<SearchedType>, size_t> &Ds,
-                               std::vector<size_t> &D) {
+                               Gram &s,
+                               const Set &S1,
+                               Table &M,
+                               Table &Ds,
+                               Distances &D) {
     if (i == q + 1) {
         M[s]  = D.back();
         Ds[s] = std::find_if(D.rbegin() + 1, D.rbegin() + m + 1, [k](size_t j) { return j <= k; }) - D.rbegin();
@@ -50,7 +57,7 @@ void preprocess_helper_hamming(ForwardIt1 first,
         s.push_back(*S1.begin());
         for (auto &c : S1) {
             auto curr = first;
-            for (int j = 1; j <= m; ++j) {
+            for (size_t j = 1; j <= m; ++j) {
                 D[i * (m + 1) + j] = D[(i - 1) * (m + 1) + j - 1] + ((c == *(curr++)) ? 0 : 1);
             }
             s.back() = c;
@@ -60,10 +67,31 @@ void preprocess_helper_hamming(ForwardIt1 first,
     }
 }
 
+/**
+ * Shift for a q-gram under Levenshtein distance: the smallest d such that the
+ * q-gram can end at one of the pattern positions m - d - k .. m - d + k, which
+ * an occurrence ending d characters later aligns it to
+ * @param D array to calculate distance between qgram and needle, its last row is the q-gram
+ * @param m length of the needle
+ * @param k number of allowed mistakes
+ */
+template <class Distances>
+size_t levenshtein_shift(const Distances &D, size_t m, size_t k) {
+    auto row = D.end() - (m + 1);
+    for (size_t d = 1; d < m; ++d) {
+        size_t low = d + k < m ? m - d - k : 0, high = std::min(m, m - d + k);
+        if (*std::min_element(row + low, row + high + 1) <= k) return d;
+    }
+    return m;
+}
+
 /**
  * Helper function for preprocessing of data for search with Levenshtein difference
  * @tparam ForwardIt1
- * @tparam SearchedType
+ * @tparam Gram q-gram, a vector of SearchedType
+ * @tparam Set
+ * @tparam Table map from q-grams to values
+ * @tparam Distances
  * @param first
  * @param last
  * @param k number of allowed mistakes
@@ -75,26 +103,26 @@ void preprocess_helper_hamming(ForwardIt1 first,
  * @param Ds array of the lengthes of jumps for qgrams
  * @param D array to calculate distance between qgram and needle
  */
-template <class ForwardIt1, class SearchedType>
+template <class ForwardIt1, class Gram, class Set, class Table, class Distances>
 void preprocess_helper_levenshtein(ForwardIt1 first,
                                    ForwardIt1 last,
                                    size_t m,
                                    size_t k,
                                    size_t q,
                                    size_t i,
-                                   std::vector<SearchedType> &s,
-                                   std::unordered_set<SearchedType> &S1,
-                                   std::map<std::vector<SearchedType>, size_t> &M,
-                                   std::map<std::vector<SearchedType>, size_t> &Ds,
-                                   std::vector<size_t> &D) {
+                                   Gram &s,
+                                   const Set &S1,
+                                   Table &M,
+                                   Table &Ds,
+                                   Distances &D) {
     if (i == q + 1) {
         M[s]  = D.back();
-        Ds[s] = std::find_if(D.rbegin() + 1, D.rbegin() + m + 1, [k](size_t j) { return j <= k; }) - D.rbegin();
+        Ds[s] = levenshtein_shift(D, m, k);
     } else {
         s.push_back(*S1.begin());
         for (auto &c : S1) {
             auto curr = first;
-            for (int j = 1; j <= m; ++j) {
+            for (size_t j = 1; j <= m; ++j) {
                 D[i * (m + 1) + j] = std::min({D[(i - 1) * (m + 1) + j] + 1, D[i * (m + 1) + j - 1] + 1,
                                                D[(i - 1) * (m + 1) + j - 1] + ((c == *(curr++)) ? 0 : 1)});
             }
@@ -109,7 +137,8 @@ void preprocess_helper_levenshtein(ForwardIt1 first,
 /**
  * Preprocessing of input for Hamming distance
  * @tparam ForwardIt1
- * @tparam SearchedType
+ * @tparam Set
+ * @tparam Table map from q-grams to values, its allocator is used for the working arrays as well
  * @param first
  * @param last
  * @param k number of allowed mistakes
@@ -118,17 +147,20 @@ void preprocess_helper_levenshtein(ForwardIt1 first,
  * @param M array of differences between qgram and needle, where deletion in the beginning are free
  * @param Ds array of the lengthes of jumps for qgrams
  */
-template <class ForwardIt1, class SearchedType>
+template <class ForwardIt1, class Set, class Table>
 void preprocess_hamming(ForwardIt1 first,
                         ForwardIt1 last,
                         size_t k,
                         size_t q,
-                        std::unordered_set<SearchedType> &S1,
-                        std::map<std::vector<SearchedType>, size_t> &M,
-                        std::map<std::vector<SearchedType>, size_t> &Ds) {
+                        const Set &S1,
+                        Table &M,
+                        Table &Ds) {
+    using Gram      = typename Table::key_type;
+    using Distances = std::vector<
+            size_t, typename std::allocator_traits<typename Table::allocator_type>::template rebind_alloc<size_t>>;
     size_t m = std::distance(first, last);
-    std::vector<size_t> D((q + 1) * (m + 1), 0);
-    auto s = std::vector<SearchedType>();
+    Distances D((q + 1) * (m + 1), 0, M.get_allocator());
+    Gram s(M.get_allocator());
     s.reserve(q);
     preprocess_helper_hamming(first, last, m, k, q, 1, s, S1, M, Ds, D);
 }
@@ -136,7 +168,8 @@ void preprocess_hamming(ForwardIt1 first,
 /**
  * Preprocessing of input for Levenshtein distance
  * @tparam ForwardIt1
- * @tparam SearchedType
+ * @tparam Set
+ * @tparam Table map from q-grams to values, its allocator is used for the working arrays as well
  * @param first
  * @param last
  * @param k number of allowed mistakes
@@ -145,18 +178,21 @@ void preprocess_hamming(ForwardIt1 first,
  * @param M array of differences between qgram and needle, where deletion in the beginning are free
  * @param Ds array of the lengthes of jumps for qgrams
  */
-template <class ForwardIt1, class SearchedType>
+template <class ForwardIt1, class Set, class Table>
 void preprocess_levenshtein(ForwardIt1 first,
                             ForwardIt1 last,
                             size_t k,
                             size_t q,
-                            std::unordered_set<SearchedType> &S1,
-                            std::map<std::vector<SearchedType>, size_t> &M,
-                            std::map<std::vector<SearchedType>, size_t> &Ds) {
+                            const Set &S1,
+                            Table &M,
+                            Table &Ds) {
+    using Gram      = typename Table::key_type;
+    using Distances = std::vector<
+            size_t, typename std::allocator_traits<typename Table::allocator_type>::template rebind_alloc<size_t>>;
     size_t m = std::distance(first, last);
-    std::vector<size_t> D((q + 1) * (m + 1), 0);
+    Distances D((q + 1) * (m + 1), 0, M.get_allocator());
 
-    auto s = std::vector<SearchedType>();
+    Gram s(M.get_allocator());
     s.reserve(q);
     preprocess_helper_levenshtein(first, last, m, k, q, 1, s, S1, M, Ds, D);
 }
@@ -184,167 +220,290 @@ bool validate_hamming(ForwardIt1 first, ForwardIt2 s_first, size_t k, size_t m)
 }
 
 /**
- * Validate that two strings are withing k errors from each other for Levenshtein distance
+ * Validate that a suffix of the text window is withing k errors from the needle for Levenshtein distance
  * @tparam ForwardIt1
  * @tparam ForwardIt2
- * @param first
+ * @param first start of the text window
  * @param s_first
  * @param k
  * @param m
+ * @param n length of the text window, m + k unless it is cut by the start of the text
  * @return
  */
 template <class ForwardIt1, class ForwardIt2>
-bool validate_levenshtein(ForwardIt1 first, ForwardIt2 s_first, size_t k, size_t m) {  // TODO bidir specialization
-    std::vector<size_t> line1(m + 1, 0), line2(m + 1, 0);
-    std::vector<size_t> *curr = &line1, *prev = &line2;
-    for (int i = 1; i < m + k + 1; ++i) {
+bool validate_levenshtein(ForwardIt1 first, ForwardIt2 s_first, size_t k, size_t m, size_t n) {  // TODO bidir specialization
+    using Line = std::vector<size_t, fuzzy::ResourceAllocator<size_t>>;
+    fuzzy::ArenaScope scope;
+    fuzzy::ResourceAllocator<size_t> alloc(fuzzy::query_resource());
+    Line line1(m + 1, 0, alloc), line2(m + 1, 0, alloc);
+    Line *curr = &line1, *prev = &line2;
+    for (size_t j = 0; j <= m; ++j) (*prev)[j] = j;  // the needle is not free, the text start is
+    for (size_t i = 1; i <= n; ++i) {
         auto f = *(first++);
         auto s = s_first;
-        for (int j = 1; j < m + 1; ++j) {
+        for (size_t j = 1; j <= m; ++j) {
             size_t a1 = (*prev)[j] + 1, a2 = (*curr)[j - 1] + 1, a3 = (*prev)[j - 1] + ((f == *(s++)) ? 0 : 1);
             (*curr)[j] = std::min({a1, a2, a3});
-            if (i == j + k && (*curr)[j] > k) return false;
         }
         std::swap(curr, prev);
     }
-    return (*prev)[m] <= k;  // TODO
+    return (*prev)[m] <= k;
 }
 
 /**
- * Validate that two strings are withing k errors from each other for Damerau-Levenshtein distance
+ * Validate that a suffix of the text window is withing k errors from the needle for Damerau-Levenshtein
+ * distance, where a transposition of adjacent characters is one error (optimal string alignment)
  * @tparam ForwardIt1
  * @tparam ForwardIt2
- * @param first
+ * @param first start of the text window
  * @param s_first
  * @param k
  * @param m
+ * @param n length of the text window, m + k unless it is cut by the start of the text
  * @return
  */
 template <class ForwardIt1, class ForwardIt2>  // TODO weights
 bool validate_damerau_levenshtein(ForwardIt1 first,
                                   ForwardIt2 s_first,
                                   size_t k,
-                                  size_t m) {  // TODO bidir specialization
-    std::vector<size_t> line1(m + 1, 0), line2(m + 1, 0), line3(m + 1, 0);
-    std::vector<size_t> *curr = &line1, *prev = &line2, *pprev = &line3;
-    for (int i = 1; i < m + k + 1; ++i) {
+                                  size_t m,
+                                  size_t n) {  // TODO bidir specialization
+    using SearchingType = typename std::iterator_traits<ForwardIt1>::value_type;
+
+    using Line = std::vector<size_t, fuzzy::ResourceAllocator<size_t>>;
+    fuzzy::ArenaScope scope;
+    fuzzy::ResourceAllocator<size_t> alloc(fuzzy::query_resource());
+    Line line1(m + 1, 0, alloc), line2(m + 1, 0, alloc), line3(m + 1, 0, alloc);
+    Line *curr = &line1, *prev = &line2, *pprev = &line3;
+    for (size_t j = 0; j <= m; ++j) (*prev)[j] = j;
+    SearchingType f_prev{};
+    for (size_t i = 1; i <= n; ++i) {
         auto f = *(first++);
         auto s = s_first;
-        for (int j = 1; j < m + 1; ++j) {
-            size_t a1 = (*prev)[j] + 1, a2 = (*curr)[j - 1] + 1, a3 = (*prev)[j - 1] + ((f == *(s++)) ? 0 : 1),
-                    a4 = (i > 1 &&j > 1 &&f = std::prev(s, 2) && std::prev(first, 1) = std::prev(s, 1))
-                         ? (*pprev)[j - 2] + 1
-                         : a3;  // TODO: forward iter; improve
+        auto p_prev = *s;
+        for (size_t j = 1; j <= m; ++j) {
+            auto p = *(s++);
+            size_t a1 = (*prev)[j] + 1, a2 = (*curr)[j - 1] + 1, a3 = (*prev)[j - 1] + ((f == p) ? 0 : 1),
+                   a4 = (i > 1 && j > 1 && f == p_prev && f_prev == p) ? (*pprev)[j - 2] + 1 : a3;
             (*curr)[j] = std::min({a1, a2, a3, a4});
-            if (i == j + k && (*curr)[j] > k) return false;
+            p_prev = p;
         }
+        f_prev = f;
 
         std::swap(curr, pprev);
         std::swap(prev, pprev);
     }
-    return (*prev)[m] <= k;  // TODO
+    return (*prev)[m] <= k;
 }
 
 /**
- * See
- * Salmela, Leena, and Jorma Tarhio.
- * "Approximate string matching with reduced alphabet."
- * and
- * Salmela, Leena, Jorma Tarhio, and Petri Kalsi.
- * "Approximate Boyer-Moore string matching for small alphabets."
- * for more information on algorithm
+ * Size of the q-gram tables of fuzzy_search for a reduced alphabet of the given size
+ * @tparam Table map from q-grams to values
+ * @param reduced_alphabet_size
+ * @param q q-gram length
+ * @return bytes allocated by both tables, approximating a tree node by its value and four pointers
+ */
+template <class Table>
+size_t qgram_tables_size(size_t reduced_alphabet_size, size_t q) {
+    using SearchedType = typename Table::key_type::value_type;
+    size_t entries     = 1;
+    for (size_t i = 0; i < q; ++i) entries *= reduced_alphabet_size;
+    return 2 * entries * (sizeof(typename Table::value_type) + 4 * sizeof(void *) + q * sizeof(SearchedType));
+}
+
+/**
+ * fuzzy_search with every container allocated by alloc. The text is read twice and never copied: once to count
+ * its characters and once to filter and verify, mapping each q-gram to the reduced alphabet as it is read. With
+ * a budget the reduced alphabet is made as large as the q-gram tables fit in it, which weakens the filter but not
+ * the result; allocations beyond the budget throw fuzzy::BudgetExceeded
  * @tparam ForwardIt1
  * @tparam ForwardIt2
- * @param first The start of the data to search in
- * @param last The end of the data to search in
- * @param s_first The start of the data to search
- * @param s_last The end of the data to search
- * @param k possible number of mistakes
- * @return
+ * @tparam Allocator
+ * @param budget memory budget alloc allocates from, nullptr if unlimited
  */
-template <class ForwardIt1, class ForwardIt2>
-ForwardIt1 fuzzy_search(
-        ForwardIt1 first, ForwardIt1 last, ForwardIt2 s_first, ForwardIt2 s_last, size_t k, bool mismatch) {
+template <class ForwardIt1, class ForwardIt2, class Allocator>
+ForwardIt1 fuzzy_search_with(ForwardIt1 first,
+                             ForwardIt1 last,
+                             ForwardIt2 s_first,
+                             ForwardIt2 s_last,
+                             size_t k,
+                             bool mismatch,
+                             const Allocator &alloc,
+                             fuzzy::MemoryBudget *budget) {
     size_t m = std::distance(s_first, s_last);  // length of needle
 
     using SearchedType  = typename std::iterator_traits<ForwardIt2>::value_type;
-    using SearchingType = typename std::iterator_traits<ForwardIt1>::value_type;
+    using Traits        = std::allocator_traits<Allocator>;
+    using Gram          = std::vector<SearchedType, typename Traits::template rebind_alloc<SearchedType>>;
+    using Set           = std::unordered_set<SearchedType, std::hash<SearchedType>, std::equal_to<SearchedType>,
+                                   typename Traits::template rebind_alloc<SearchedType>>;
+    using Mapping       = std::map<SearchedType, SearchedType, std::less<SearchedType>,
+                             typename Traits::template rebind_alloc<std::pair<const SearchedType, SearchedType>>>;
+    using Count         = std::map<SearchedType, size_t, std::less<SearchedType>,
+                           typename Traits::template rebind_alloc<std::pair<const SearchedType, size_t>>>;
+    using Frequency     = std::pair<SearchedType, size_t>;
+    using Frequencies   = std::vector<Frequency, typename Traits::template rebind_alloc<Frequency>>;
+    using Table         = std::map<Gram, size_t, std::less<Gram>,
+                           typename Traits::template rebind_alloc<std::pair<const Gram, size_t>>>;
+    using ReducedIt     = typename Gram::iterator;
     auto preprocess =
-            mismatch ? preprocess_hamming<ForwardIt2, SearchedType> : preprocess_levenshtein<ForwardIt2, SearchedType>;
-    auto validate = mismatch ? validate_hamming<ForwardIt1, ForwardIt2> : validate_levenshtein<ForwardIt1, ForwardIt2>;
+            mismatch ? preprocess_hamming<ReducedIt, Set, Table> : preprocess_levenshtein<ReducedIt, Set, Table>;
 
     // TODO optimal parameters and corner cases
     size_t reduced_alphabet_size = 16;  // size of reduced alphabet
     size_t q = 6;   // size of qgrams
     // should depend on searched data size
 
-    size_t start_search_position = mismatch ? m - q : m - k - q;
+    // the first q-gram ends where the shortest occurrence can end
+    size_t n = std::distance(first, last);
+    size_t shortest = mismatch ? m : m - std::min(m, k);
+    if (shortest < q || n < shortest) return last;
+    size_t start_search_position = shortest - q;
 
-    std::unordered_set<SearchedType> S(s_first, s_last);  // S is set of all chars in P
-    std::vector<SearchingType> T1(first, last);           // T1 is copy of T
+    Set S(s_first, s_last, 0, std::hash<SearchedType>(), std::equal_to<SearchedType>(), alloc);  // S is set of all chars in P
 
-    std::map<SearchedType, size_t> count;
+    Count count(alloc);
     bool added = false;
-    SearchingType extra;  // extra character replacing everything not present in P
-    for (auto it = T1.begin(); it != T1.end(); ++it) {
-        if (S.find(*it) == S.end()) {
+    SearchedType extra{};  // extra character replacing everything not present in P
+    for (auto it = first; it != last; ++it) {
+        SearchedType c = *it;
+        if (S.find(c) == S.end()) {
             if (added) {
-                *it = extra;
+                c = extra;
             } else {
                 added = true;
-                extra = *it;
-                S.insert(*it);  // add extra character to S. Now S is pattern alphabet
+                extra = c;
+                S.insert(c);  // add extra character to S. Now S is pattern alphabet
             }
         }
-        count[*it] += 1;
+        count[c] += 1;
     }
 
-    std::vector<std::pair<size_t, size_t>> freq(count.begin(), count.end());
+    Frequencies freq(count.begin(), count.end(), alloc);
     // sort by frequency
-    std::sort(freq.begin(), freq.end(),
-              [](std::pair<size_t, size_t> a, std::pair<size_t, size_t> b) { return b.second < a.second; });
+    std::sort(freq.begin(), freq.end(), [](const Frequency &a, const Frequency &b) { return b.second < a.second; });
 
-    std::unordered_set<SearchedType> S1;           // S1 is reduced pattern alphabet (Sigma')
-    std::map<SearchedType, SearchedType> mapping;  //  mapping  Sigma -> Sigma'
+    reduced_alphabet_size = std::min(reduced_alphabet_size, freq.size());
+    if (budget != nullptr) {
+        // the pattern, the distance arrays and the alphabet maps are small next to the q-gram tables
+        size_t small = (q + 2) * (m + 1) * sizeof(size_t) + freq.size() * (sizeof(Frequency) + 8 * sizeof(void *));
+        while (reduced_alphabet_size > 1 &&
+               !budget->fits(small + qgram_tables_size<Table>(reduced_alphabet_size, q))) {
+            --reduced_alphabet_size;
+        }
+    }
+    Set S1(0, std::hash<SearchedType>(), std::equal_to<SearchedType>(), alloc);  // S1 is reduced pattern alphabet (Sigma')
+    Mapping mapping(alloc);                                                        //  mapping  Sigma -> Sigma'
     for (size_t i = 0; i < reduced_alphabet_size; ++i) {
         mapping[freq[i].first] = freq[i].first;  // most frequent chars are mapped to themselves
         S1.insert(freq[i].first);
     }
-    std::vector<std::pair<size_t, size_t>> freq_reduced(
-            freq.begin(),
-            freq.begin() + reduced_alphabet_size);  // frequency of reduced alphabet
+    Frequencies freq_reduced(freq.begin(), freq.begin() + reduced_alphabet_size,
+                             alloc);  // frequency of reduced alphabet
     for (size_t i = reduced_alphabet_size; i < freq.size(); ++i) {
         mapping[freq[i].first] = freq_reduced.back().first;  // most frequent char mapped to least frequent in reduced
         freq_reduced.back().second += freq[i].second;
-        std::sort(freq_reduced.begin(), freq_reduced.end(), [](std::pair<size_t, size_t> a, std::pair<size_t, size_t> b) {
+        std::sort(freq_reduced.begin(), freq_reduced.end(), [](const Frequency &a, const Frequency &b) {
             return b.second < a.second;
         });  // TODO: optimal?
     }
 
-    std::vector<SearchedType> P1(s_first, s_last);  // P1 is copy of P1
+    // every text character not in P is mapped as extra is
+    SearchedType extra_reduced = added ? mapping[extra] : SearchedType();
+    auto reduce = [&mapping, extra_reduced](const SearchedType &c) {
+        auto found = mapping.find(c);
+        return found != mapping.end() ? found->second : extra_reduced;
+    };
+
+    Gram P1(s_first, s_last, alloc);  // P1 is copy of P mapped to Sigma', as the q-grams are
     for (auto it = P1.begin(); it != P1.end(); ++it) {
         *it = mapping[*it];
     }
 
-    std::map<std::vector<SearchedType>, size_t> M, Ds;
-    preprocess(s_first, s_last, k, q, S1, M, Ds);
+    Table M(alloc), Ds(alloc);
+    preprocess(P1.begin(), P1.end(), k, q, S1, M, Ds);
 
-    for (auto it = T1.begin(); it != T1.end(); ++it) {
-        *it = mapping[*it];
-    }
+    FUZZY_STATS_ADD(bytes_scanned, n);
 
-    auto s = std::next(T1.begin(), start_search_position);
-    while (std::distance(s, T1.end()) > q) {
-        std::vector<SearchingType> current_gram(s, std::next(s, q));
-        if (M[current_gram] <= k) {
-            auto orig_s = std::next(first, std::distance(T1.begin(), s + q - m - k));
-            if (validate(orig_s, s_first, k, m)) return orig_s;
+    // the q-gram at s ends the candidate occurrence, which is verified in the original text:
+    // the m characters before its end for Hamming distance, up to m + k for Levenshtein distance
+    Gram current_gram(q, SearchedType(), alloc);
+    size_t position = start_search_position;
+    auto s = std::next(first, position);
+    while (n - position >= q) {
+        auto c = s;
+        for (auto &g : current_gram) g = reduce(*(c++));
+        size_t distance = M.find(current_gram)->second, shift = Ds.find(current_gram)->second;
+        if (distance <= k) {
+            FUZZY_STATS_ADD(filter_hits, 1);
+            FUZZY_STATS_ADD(verifications, 1);
+            size_t end    = position + q;
+            size_t window = mismatch ? m : std::min(m + k, end);
+            auto orig_s   = std::next(first, end - window);
+            if (mismatch ? validate_hamming(orig_s, s_first, k, m)
+                         : validate_levenshtein(orig_s, s_first, k, m, window)) {
+                FUZZY_STATS_ADD(verifications_passed, 1);
+                return orig_s;
+            }
         }
-        if (std::distance(s, T1.end()) <= Ds[current_gram] + q - 1) break;
-        s = std::next(s, Ds[current_gram]);
+        if (n - position <= shift + q - 1) break;
+        FUZZY_STATS_ADD(shifts, 1);
+        FUZZY_STATS_ADD(shift_length, shift);
+        s = std::next(s, shift);
+        position += shift;
     }
 
     return last;
 }
 
+/**
+ * See
+ * Salmela, Leena, and Jorma Tarhio.
+ * "Approximate string matching with reduced alphabet."
+ * and
+ * Salmela, Leena, Jorma Tarhio, and Petri Kalsi.
+ * "Approximate Boyer-Moore string matching for small alphabets."
+ * for more information on algorithm
+ * @tparam ForwardIt1
+ * @tparam ForwardIt2
+ * @param first The start of the data to search in
+ * @param last The end of the data to search in
+ * @param s_first The start of the data to search
+ * @param s_last The end of the data to search
+ * @param k possible number of mistakes
+ * @param mismatch Hamming distance if true, Levenshtein distance otherwise
+ * @return For Hamming distance the start of the leftmost occurrence. For Levenshtein distance the start of the
+ * m + k character window (cut at first) ending with the leftmost occurrence end. last if there is no occurrence
+ * or the needle is shorter than q + k
+ */
+template <class ForwardIt1, class ForwardIt2>
+ForwardIt1 fuzzy_search(
+        ForwardIt1 first, ForwardIt1 last, ForwardIt2 s_first, ForwardIt2 s_last, size_t k, bool mismatch) {
+    using SearchedType = typename std::iterator_traits<ForwardIt2>::value_type;
+    fuzzy::ArenaScope scope;
+    return fuzzy_search_with(first, last, s_first, s_last, k, mismatch,
+                             fuzzy::ResourceAllocator<SearchedType>(fuzzy::query_resource()), nullptr);
+}
+
+/**
+ * fuzzy_search within a memory budget, which reports the peak allocation of the search. The q-gram tables take
+ * up to 2 * 16^6 entries; when they do not fit, a smaller reduced alphabet is used, down to a single symbol
+ * where every position is verified
+ * @param budget
+ * @return as fuzzy_search
+ * @throws fuzzy::BudgetExceeded if the search does not fit even then
+ */
+template <class ForwardIt1, class ForwardIt2>
+ForwardIt1 fuzzy_search(ForwardIt1 first,
+                        ForwardIt1 last,
+                        ForwardIt2 s_first,
+                        ForwardIt2 s_last,
+                        size_t k,
+                        bool mismatch,
+                        fuzzy::MemoryBudget &budget) {
+    using SearchedType = typename std::iterator_traits<ForwardIt2>::value_type;
+    return fuzzy_search_with(first, last, s_first, s_last, k, mismatch,
+                             fuzzy::ResourceAllocator<SearchedType>(budget), &budget);
+}
+
 #endif  // BOOST_ALGORITHM_FUZZY_SEARCH_H
\ No newline at end of file
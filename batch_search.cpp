@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <seqan/file.h>
+
+#include "FuzzySearcher.hpp"
+
+/**
+ * Batch search of a file of patterns, one per line, in one or more text
+ * files with FuzzySearcher.
+ *
+ * The text files are memory-mapped and searched in place. Every (text,
+ * pattern) pair is a query; worker threads take the queries in order and the
+ * main thread writes their matches in the same order as they complete, so the
+ * output does not depend on the number of threads. Threads left over when
+ * there are fewer queries verify the candidates of the Pex queries (see
+ * FuzzySearcher::set_threads). With --one-pass every text is one query for
+ * all patterns instead, and the Levenshtein patterns a filter suits are
+ * searched in a single pass over it (see FuzzySearcher::search).
+ *
+ * With --memory-limit every query runs within its own fuzzy::MemoryBudget of
+ * that many bytes; a query that does not fit is reported as failed instead of
+ * taking the memory of the whole process.
+ *
+ * Output formats:
+ * - tsv: a header line, then "text<TAB>pattern<TAB>end<TAB>errors" per match,
+ *   where text is the file name, pattern the 0-based line of the pattern in
+ *   the pattern file, empty lines counted, and end is one past the last text
+ *   byte of the occurrence
+ * - binary: one BinaryMatch record per match in host byte order
+ */
+
+struct Options
+{
+    std::string patterns;
+    std::vector<std::string> texts;
+    fuzzy::Metric metric = fuzzy::Metric::Levenshtein;
+    fuzzy::Engine engine = fuzzy::Engine::Auto;
+    size_t k = 0;
+    size_t threads = 0; // 0: one per hardware thread
+    size_t memory_limit = 0; // bytes per query, 0: unlimited
+    bool one_pass = false;   // one query per text for all patterns
+    std::string format = "tsv";
+    std::string output;
+};
+
+// the record of the binary format, 24 bytes
+struct BinaryMatch
+{
+    uint32_t text;      // index of the text file on the command line
+    uint32_t pattern;   // 0-based line of the pattern, empty lines counted
+    uint64_t end;       // one past the last text byte of the occurrence
+    uint32_t errors;
+    uint32_t reserved;  // zero
+};
+
+static const char * const USAGE =
+        "usage: FuzzySearchBatch --patterns FILE [--k K] [--metric hamming|edit] [--engine E] [--one-pass]\n"
+        "                        [--threads T] [--memory-limit BYTES] [--format tsv|binary] [--output FILE] TEXT..\n"
+        "\n"
+        "engines: auto, bitap, randl, flasm, seqan_hamming, seqan_shiftadd, seqan_myers, seqan_abndm,\n"
+        "         seqan_pex, seqan_horspool (k = 0 only)\n"
+        "patterns are read one per line, empty lines are skipped but counted in the pattern column.\n"
+        "threads defaults to the number of hardware threads.\n"
+        "memory-limit bounds the memory of each query, queries that exceed it fail.\n"
+        "one-pass searches all patterns of a text in one query, with one pass of the text for the\n"
+        "edit distance patterns that suit the pigeonhole filter.\n";
+
+// a read-only memory mapping of a whole file
+class MappedText
+{
+public:
+    explicit MappedText(const std::string & name) : name_(name)
+    {
+        if (!seqan::open(mapping_, name.c_str(), seqan::OPEN_RDONLY))
+        {
+            throw std::runtime_error("cannot open " + name);
+        }
+        size_ = seqan::length(mapping_);
+        if (size_ > 0)
+        {
+            data_ = static_cast<const char *>(seqan::mapFileSegment(mapping_, 0, size_, seqan::MAP_RDONLY));
+            seqan::adviseFileSegment(mapping_, seqan::MAP_SEQUENTIAL, const_cast<char *>(data_), 0, size_);
+        }
+    }
+
+    MappedText(const MappedText &) = delete;
+    MappedText & operator=(const MappedText &) = delete;
+
+    ~MappedText()
+    {
+        if (data_ != nullptr)
+        {
+            seqan::unmapFileSegment(mapping_, const_cast<char *>(data_), size_);
+        }
+        seqan::close(mapping_);
+    }
+
+    const std::string & name() const { return name_; }
+
+    const char * data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+private:
+    std::string name_;
+    seqan::FileMapping<> mapping_;
+    const char * data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// the matches of each pattern of one query, or why it failed
+struct QueryResult
+{
+    std::vector<std::vector<fuzzy::Match>> matches;
+    std::string error;
+    bool done = false;
+};
+
+// the non-empty lines of the file, with their 0-based line numbers in lines
+static std::vector<std::string> read_patterns(const std::string & name, std::vector<size_t> & lines)
+{
+    std::ifstream file(name);
+    if (!file)
+    {
+        throw std::runtime_error("cannot open " + name);
+    }
+
+    std::vector<std::string> patterns;
+    std::string line;
+    for (size_t number = 0; std::getline(file, line); ++number)
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty())
+        {
+            patterns.push_back(line);
+            lines.push_back(number);
+        }
+    }
+    return patterns;
+}
+
+static bool parse_engine(const std::string & name, fuzzy::Engine & engine)
+{
+    for (fuzzy::Engine e : {fuzzy::Engine::Auto, fuzzy::Engine::Bitap, fuzzy::Engine::Randl, fuzzy::Engine::Flasm,
+                            fuzzy::Engine::HammingSimple, fuzzy::Engine::HammingShiftAdd, fuzzy::Engine::Myers,
+                            fuzzy::Engine::Abndm, fuzzy::Engine::Pex, fuzzy::Engine::Horspool})
+    {
+        if (name == fuzzy::engine_name(e))
+        {
+            engine = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_options(int argc, char ** argv, Options & options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string key = argv[i];
+        if (key.compare(0, 2, "--") != 0)
+        {
+            options.texts.push_back(key);
+            continue;
+        }
+        if (key == "--one-pass")
+        {
+            options.one_pass = true;
+            continue;
+        }
+        if (key == "--help" || i + 1 == argc)
+        {
+            return false;
+        }
+
+        std::string value = argv[++i];
+        if (key == "--patterns")
+            options.patterns = value;
+        else if (key == "--k")
+            options.k = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--threads")
+            options.threads = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--memory-limit")
+            options.memory_limit = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--format")
+            options.format = value;
+        else if (key == "--output")
+            options.output = value;
+        else if (key == "--metric" && (value == "hamming" || value == "edit"))
+            options.metric = value == "hamming" ? fuzzy::Metric::Hamming : fuzzy::Metric::Levenshtein;
+        else if (key == "--engine")
+        {
+            if (!parse_engine(value, options.engine))
+                return false;
+        }
+        else
+            return false;
+    }
+    return !options.patterns.empty() && !options.texts.empty() &&
+           (options.format == "tsv" || options.format == "binary");
+}
+
+static void write_matches(std::ostream & out, const Options & options, size_t text, size_t pattern,
+                          const std::vector<fuzzy::Match> & matches)
+{
+    if (options.format == "binary")
+    {
+        for (const fuzzy::Match & match : matches)
+        {
+            BinaryMatch record = {static_cast<uint32_t>(text), static_cast<uint32_t>(pattern), match.end,
+                                  static_cast<uint32_t>(match.errors), 0};
+            out.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        }
+        return;
+    }
+
+    for (const fuzzy::Match & match : matches)
+    {
+        out << options.texts[text] << '\t' << pattern << '\t' << match.end << '\t' << match.errors << '\n';
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << USAGE;
+        return 1;
+    }
+
+    std::vector<std::string> patterns;
+    std::vector<size_t> lines;
+    std::vector<std::unique_ptr<MappedText>> texts;
+    try
+    {
+        patterns = read_patterns(options.patterns, lines);
+        for (const auto & name : options.texts)
+        {
+            texts.emplace_back(new MappedText(name));
+        }
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << "FuzzySearchBatch: " << e.what() << '\n';
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!options.output.empty())
+    {
+        file.open(options.output, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "FuzzySearchBatch: cannot open " << options.output << '\n';
+            return 1;
+        }
+    }
+    std::ostream & out = options.output.empty() ? std::cout : file;
+    if (options.format == "tsv")
+    {
+        out << "text\tpattern\tend\terrors\n";
+    }
+
+    // queries run text by text, so the workers share the pages of one mapping
+    const size_t per_text = options.one_pass ? 1 : patterns.size();
+    const size_t queries = texts.size() * per_text;
+    std::vector<QueryResult> results(queries);
+    std::atomic<size_t> next(0);
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    // threads left over when there are fewer queries go to the Pex verification of each
+    const size_t threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    const size_t workers = std::min(threads, std::max<size_t>(queries, 1));
+    fuzzy::FuzzySearcher searcher(options.metric, options.engine);
+    searcher.set_threads(threads / workers);
+    auto worker = [&]() {
+        for (size_t q = next++; q < queries; q = next++)
+        {
+            const MappedText & text = *texts[q / per_text];
+            QueryResult result;
+            try
+            {
+                fuzzy::FuzzySearcher query_searcher = searcher;
+                fuzzy::MemoryBudget budget(options.memory_limit != 0 ? options.memory_limit
+                                                                     : fuzzy::MemoryBudget::UNLIMITED);
+                if (options.memory_limit != 0)
+                {
+                    query_searcher.set_memory_budget(&budget);
+                }
+                if (options.one_pass)
+                    result.matches = query_searcher.search(text.data(), text.size(), patterns, options.k);
+                else
+                    result.matches.push_back(query_searcher.search(text.data(), text.size(),
+                                                                   patterns[q % per_text], options.k));
+            }
+            catch (const std::exception & e)
+            {
+                result.error = e.what();
+            }
+            result.done = true;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            results[q] = std::move(result);
+            finished.notify_one();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < workers; ++i)
+    {
+        pool.emplace_back(worker);
+    }
+
+    // write the results in query order while later queries are still running
+    int status = 0;
+    for (size_t q = 0; q < queries; ++q)
+    {
+        QueryResult result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]() { return results[q].done; });
+            result = std::move(results[q]);
+        }
+
+        const size_t first = options.one_pass ? 0 : q % per_text;
+        if (!result.error.empty())
+        {
+            std::cerr << "FuzzySearchBatch: " << texts[q / per_text]->name();
+            if (!options.one_pass)
+                std::cerr << ", pattern line " << lines[first];
+            std::cerr << ": " << result.error << '\n';
+            status = 1;
+            continue;
+        }
+        for (size_t i = 0; i < result.matches.size(); ++i)
+        {
+            write_matches(out, options, q / per_text, lines[first + i], result.matches[i]);
+        }
+    }
+
+    for (auto & thread : pool)
+    {
+        thread.join();
+    }
+
+    out.flush();
+    return out ? status : 1;
+}
@@ -0,0 +1,569 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Randl_fuzzy_search.hpp"
+#include "Bitap.hpp"
+#include "libflasm.h"
+#include "FuzzySearcher.hpp"
+
+/**
+ * Benchmark of all fuzzy search engines of the library over a sweep of text
+ * sizes, pattern lengths, error limits, alphabets and match densities.
+ *
+ * Every engine reports all occurrences of the pattern with at most k errors.
+ * Engines that only return the first match are restarted after every match.
+ * Each case is run with a fixed seed, timed with a steady clock after warmup
+ * runs and summarised as throughput and p50/p99 latency in CSV or JSON.
+ */
+
+enum Metric
+{
+    HAMMING,
+    EDIT
+};
+
+struct BenchmarkCase
+{
+    std::string alphabet;
+    size_t text_size;
+    size_t pattern_length;
+    size_t k;
+    size_t density; // planted matches per MB of text
+};
+
+// the text and pattern of a case, also as SeqAn strings so that no engine pays for a conversion
+struct BenchmarkInput
+{
+    std::string text;
+    std::string pattern;
+    seqan::CharString seqan_text;
+    seqan::CharString seqan_pattern;
+};
+
+struct Engine
+{
+    const char * name;
+    Metric metric;
+    std::function<bool(const BenchmarkCase &, const BenchmarkInput &)> supports;
+    std::function<size_t(BenchmarkInput &, size_t)> run; // returns the number of matches
+};
+
+struct Sample
+{
+    BenchmarkCase c;
+    const Engine * engine;
+    size_t matches;
+    size_t reps;
+    double mean_us;
+    double p50_us;
+    double p99_us;
+    double throughput_mb_s;
+    fuzzy::SearchStats stats; // counters of the last repetition, built with FUZZY_SEARCH_STATS
+};
+
+struct Options
+{
+    std::vector<size_t> sizes = {1 << 16, 1 << 20};
+    std::vector<size_t> patterns = {8, 16, 32};
+    std::vector<size_t> ks = {0, 1, 2};
+    std::vector<std::string> alphabets = {"dna", "protein", "english", "bytes"};
+    std::vector<size_t> densities = {0, 100};
+    std::vector<std::string> engines = {"bitap", "flasm_hd", "flasm_ed", "seqan_hamming", "seqan_shiftadd",
+                                        "seqan_myers", "seqan_abndm", "seqan_pex", "seqan_pex_pipelined",
+                                        "seqan_horspool"};
+    size_t warmup = 1;
+    size_t reps = 5;
+    double budget = 5.0; // seconds per engine and case
+    unsigned int seed = 42;
+    std::string format = "csv";
+    std::string output;
+};
+
+static const char * const USAGE =
+        "usage: FuzzySearchBenchmark [--sizes N,..] [--patterns M,..] [--k K,..]\n"
+        "                            [--alphabets dna,protein,english,bytes] [--density D,..]\n"
+        "                            [--engines E,..] [--warmup W] [--reps R] [--budget SECONDS]\n"
+        "                            [--seed S] [--format csv|json] [--output FILE]\n"
+        "\n"
+        "engines: bitap, randl_hd, randl_ed, flasm_hd, flasm_ed, seqan_hamming, seqan_shiftadd,\n"
+        "         seqan_myers, seqan_abndm, seqan_pex, seqan_pex_pipelined, seqan_horspool, auto_hd,\n"
+        "         auto_ed\n"
+        "seqan_horspool only runs cases with k = 0.\n"
+        "randl_* are not run by default: every call enumerates up to 16^6 reduced q-grams.\n"
+        "auto_* run FuzzySearcher with automatic engine selection and are not run by default.\n"
+        "density is the number of planted matches per MB of text.\n";
+
+/**
+ * Generates text over the named alphabet: uniform DNA, protein or bytes, and
+ * English drawn from letter frequencies with spaces
+ */
+static std::string generate_text(const std::string & alphabet, size_t size, std::mt19937 & rng)
+{
+    std::string text(size, ' ');
+
+    if (alphabet == "english")
+    {
+        static const char letters[] = "etaoinshrdlcumwfgypbvkjxqz ";
+        static const double weights[] = {12.7, 9.1, 8.2, 7.5, 7.0, 6.7, 6.3, 6.1, 6.0, 4.3, 4.0, 2.8, 2.8, 2.4,
+                                         2.4,  2.2, 2.0, 2.0, 1.9, 1.5, 1.0, 0.8, 0.2, 0.2, 0.1, 0.1, 18.0};
+        std::discrete_distribution<int> letter(std::begin(weights), std::end(weights));
+        for (auto & c : text)
+        {
+            c = letters[letter(rng)];
+        }
+        return text;
+    }
+
+    std::string symbols;
+    if (alphabet == "dna")
+    {
+        symbols = "ACGT";
+    }
+    else if (alphabet == "protein")
+    {
+        symbols = "ACDEFGHIKLMNPQRSTVWY";
+    }
+    else
+    {
+        for (int c = 0; c < 256; ++c)
+        {
+            symbols.push_back(static_cast<char>(c));
+        }
+    }
+
+    std::uniform_int_distribution<size_t> symbol(0, symbols.size() - 1);
+    for (auto & c : text)
+    {
+        c = symbols[symbol(rng)];
+    }
+    return text;
+}
+
+/**
+ * Copies the pattern into the text at random positions, each copy with up to k
+ * substitutions, so it is a match for both metrics
+ */
+static void plant_matches(std::string & text, const std::string & pattern, const BenchmarkCase & c, std::mt19937 & rng)
+{
+    if (text.size() < pattern.size())
+    {
+        return;
+    }
+
+    size_t count = c.density * text.size() / (1 << 20);
+    std::uniform_int_distribution<size_t> position(0, text.size() - pattern.size());
+    std::uniform_int_distribution<size_t> offset(0, pattern.size() - 1);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t p = position(rng);
+        std::copy(pattern.begin(), pattern.end(), text.begin() + p);
+        for (size_t e = 0; e < c.k; ++e)
+        {
+            text[p + offset(rng)] = text[position(rng)];
+        }
+    }
+}
+
+template <typename TPattern>
+static size_t count_seqan(seqan::CharString & text, TPattern & pattern, int score)
+{
+    seqan::Finder<seqan::CharString> finder(text);
+    size_t matches = 0;
+    while (seqan::find(finder, pattern, score))
+    {
+        ++matches;
+    }
+    return matches;
+}
+
+static size_t count_flasm(const libflasm::ResultTupleSet & results)
+{
+    return results.size();
+}
+
+static std::vector<Engine> all_engines()
+{
+    auto seven_bit = [](const BenchmarkCase & c) { return c.alphabet != "bytes"; };
+
+    std::vector<Engine> engines;
+
+    engines.push_back({"bitap", HAMMING,
+                       [](const BenchmarkCase & c, const BenchmarkInput &) { return c.pattern_length <= 31; },
+                       [](BenchmarkInput & input, size_t k) {
+                           std::string & text = input.text;
+                           std::string & pattern = input.pattern;
+                           size_t matches = 0;
+                           auto it = text.begin();
+                           while (true)
+                           {
+                               auto result = bitap_fuzzy_bitwise_search_new(it, text.end(), pattern.begin(),
+                                                                            pattern.end(), k);
+                               if (result.first == result.second)
+                               {
+                                   return matches;
+                               }
+                               ++matches;
+                               it = result.second - pattern.size() + 1;
+                           }
+                       }});
+
+    // fuzzy_search reads q-grams of length 6, which must fit into the shortest occurrence
+    auto randl_supports = [](const BenchmarkCase & c, const BenchmarkInput &) {
+        return c.pattern_length >= 6 + c.k;
+    };
+    auto randl_run = [](bool mismatch) {
+        return [mismatch](BenchmarkInput & input, size_t k) {
+            std::string & text = input.text;
+            std::string & pattern = input.pattern;
+            size_t matches = 0;
+            auto it = text.begin();
+            while (it != text.end())
+            {
+                it = fuzzy_search(it, text.end(), pattern.begin(), pattern.end(), k, mismatch);
+                if (it == text.end())
+                {
+                    break;
+                }
+                ++matches;
+                ++it;
+            }
+            return matches;
+        };
+    };
+    engines.push_back({"randl_hd", HAMMING, randl_supports, randl_run(true)});
+    engines.push_back({"randl_ed", EDIT, randl_supports, randl_run(false)});
+
+    auto always = [](const BenchmarkCase &, const BenchmarkInput &) { return true; };
+
+    engines.push_back({"flasm_hd", HAMMING, always, [](BenchmarkInput & input, size_t k) {
+                           return count_flasm(libflasm::flasm_hd(
+                                   reinterpret_cast<unsigned char *>(&input.text[0]), input.text.size(),
+                                   reinterpret_cast<unsigned char *>(&input.pattern[0]), input.pattern.size(),
+                                   input.pattern.size(),
+                                   k, true));
+                       }});
+    engines.push_back({"flasm_ed", EDIT, always, [](BenchmarkInput & input, size_t k) {
+                           return count_flasm(libflasm::flasm_ed(
+                                   reinterpret_cast<unsigned char *>(&input.text[0]), input.text.size(),
+                                   reinterpret_cast<unsigned char *>(&input.pattern[0]), input.pattern.size(),
+                                   input.pattern.size(),
+                                   k, true));
+                       }});
+
+    engines.push_back({"seqan_hamming", HAMMING, always, [](BenchmarkInput & input, size_t k) {
+                           seqan::Pattern<seqan::CharString, seqan::HammingSimple> p(input.seqan_pattern);
+                           return count_seqan(input.seqan_text, p, -static_cast<int>(k));
+                       }});
+    engines.push_back({"seqan_shiftadd", HAMMING, always, [](BenchmarkInput & input, size_t k) {
+                           seqan::Pattern<seqan::CharString, seqan::HammingShiftAdd> p(input.seqan_pattern);
+                           return count_seqan(input.seqan_text, p, -static_cast<int>(k));
+                       }});
+    engines.push_back({"seqan_myers", EDIT, always, [](BenchmarkInput & input, size_t k) {
+                           seqan::Pattern<seqan::CharString, seqan::Myers<> > p(input.seqan_pattern);
+                           return count_seqan(input.seqan_text, p, -static_cast<int>(k));
+                       }});
+    // the ABNDM bit tables are indexed with plain chars
+    engines.push_back({"seqan_abndm", EDIT,
+                       [seven_bit](const BenchmarkCase & c, const BenchmarkInput &) {
+                           return seven_bit(c) && c.pattern_length > c.k;
+                       },
+                       [](BenchmarkInput & input, size_t k) {
+                           seqan::Pattern<seqan::CharString, seqan::AbndmAlgo> p(input.seqan_pattern, -static_cast<int>(k));
+                           return count_seqan(input.seqan_text, p, -static_cast<int>(k));
+                       }});
+    engines.push_back({"seqan_pex", EDIT, [](const BenchmarkCase & c, const BenchmarkInput &) { return c.pattern_length > c.k; },
+                       [](BenchmarkInput & input, size_t k) {
+                           seqan::Pattern<seqan::CharString, seqan::PexNonHierarchical> p(input.seqan_pattern,
+                                                                                          -static_cast<int>(k));
+                           seqan::Finder<seqan::CharString> finder(input.seqan_text);
+                           size_t matches = 0;
+                           while (seqan::find(finder, p))
+                           {
+                               ++matches;
+                           }
+                           return matches;
+                       }});
+    // verifies on one thread per hardware thread
+    engines.push_back({"seqan_pex_pipelined", EDIT,
+                       [](const BenchmarkCase & c, const BenchmarkInput &) { return c.pattern_length > c.k; },
+                       [](BenchmarkInput & input, size_t k) {
+                           seqan::Pattern<seqan::CharString, seqan::PexPipelined> p(input.seqan_pattern,
+                                                                                    -static_cast<int>(k));
+                           seqan::Finder<seqan::CharString> finder(input.seqan_text);
+                           size_t matches = 0;
+                           while (seqan::find(finder, p))
+                           {
+                               ++matches;
+                           }
+                           return matches;
+                       }});
+
+    // exact search only, an occurrence has no errors under either metric
+    engines.push_back({"seqan_horspool", HAMMING, [](const BenchmarkCase & c, const BenchmarkInput &) { return c.k == 0; },
+                       [](BenchmarkInput & input, size_t) {
+                           seqan::Pattern<seqan::CharString, seqan::Horspool> p(input.seqan_pattern);
+                           seqan::Finder<seqan::CharString> finder(input.seqan_text);
+                           size_t matches = 0;
+                           while (seqan::find(finder, p))
+                           {
+                               ++matches;
+                           }
+                           return matches;
+                       }});
+
+    // the facade with automatic engine selection, to check its choices against the engines above
+    auto facade_run = [](fuzzy::Metric metric) {
+        return [metric](BenchmarkInput & input, size_t k) {
+            return fuzzy::FuzzySearcher(metric).search(input.text, input.pattern, k).size();
+        };
+    };
+    engines.push_back({"auto_hd", HAMMING, always, facade_run(fuzzy::Metric::Hamming)});
+    engines.push_back({"auto_ed", EDIT, always, facade_run(fuzzy::Metric::Levenshtein)});
+
+    return engines;
+}
+
+/**
+ * Nearest-rank percentile of sorted timings
+ */
+static double percentile(const std::vector<double> & sorted, double p)
+{
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+static Sample measure(const Engine & engine, const BenchmarkCase & c, BenchmarkInput & input, const Options & options)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Sample sample = {c, &engine, 0, 0, 0, 0, 0, 0, fuzzy::SearchStats()};
+    Clock::time_point started = Clock::now();
+
+    for (size_t i = 0; i < options.warmup; ++i)
+    {
+        sample.matches = engine.run(input, c.k);
+    }
+
+    std::vector<double> timings;
+    for (size_t i = 0; i < options.reps; ++i)
+    {
+        fuzzy::reset_search_stats();
+        Clock::time_point begin = Clock::now();
+        sample.matches = engine.run(input, c.k);
+        timings.push_back(std::chrono::duration<double, std::micro>(Clock::now() - begin).count());
+        sample.stats = fuzzy::search_stats();
+
+        // keep at least one repetition, but do not let a slow engine stall the sweep
+        if (std::chrono::duration<double>(Clock::now() - started).count() > options.budget)
+        {
+            break;
+        }
+    }
+
+    std::sort(timings.begin(), timings.end());
+    sample.reps = timings.size();
+    for (double t : timings)
+    {
+        sample.mean_us += t / timings.size();
+    }
+    sample.p50_us = percentile(timings, 50);
+    sample.p99_us = percentile(timings, 99);
+    sample.throughput_mb_s = sample.p50_us > 0 ? c.text_size / sample.p50_us : 0;
+    return sample;
+}
+
+static void write_csv(std::ostream & out, const std::vector<Sample> & samples)
+{
+    out << "engine,metric,alphabet,text_size,pattern_length,k,density,matches,reps,mean_us,p50_us,p99_us,"
+           "throughput_mb_s";
+    if (fuzzy::search_stats_enabled)
+    {
+        out << ",bytes_scanned,shifts,shift_length,filter_hits,verifications,verifications_passed,myers_blocks,"
+               "cells";
+    }
+    out << '\n';
+    for (const auto & s : samples)
+    {
+        out << s.engine->name << ',' << (s.engine->metric == HAMMING ? "hamming" : "edit") << ','
+            << s.c.alphabet << ',' << s.c.text_size << ',' << s.c.pattern_length << ',' << s.c.k << ','
+            << s.c.density << ',' << s.matches << ',' << s.reps << ',' << s.mean_us << ',' << s.p50_us << ','
+            << s.p99_us << ',' << s.throughput_mb_s;
+        if (fuzzy::search_stats_enabled)
+        {
+            out << ',' << s.stats.bytes_scanned << ',' << s.stats.shifts << ',' << s.stats.shift_length << ','
+                << s.stats.filter_hits << ',' << s.stats.verifications << ',' << s.stats.verifications_passed
+                << ',' << s.stats.myers_blocks << ',' << s.stats.cells;
+        }
+        out << '\n';
+    }
+}
+
+static void write_json(std::ostream & out, const std::vector<Sample> & samples)
+{
+    out << "[\n";
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        const Sample & s = samples[i];
+        out << "  {\"engine\": \"" << s.engine->name << "\", \"metric\": \""
+            << (s.engine->metric == HAMMING ? "hamming" : "edit") << "\", \"alphabet\": \"" << s.c.alphabet
+            << "\", \"text_size\": " << s.c.text_size << ", \"pattern_length\": " << s.c.pattern_length
+            << ", \"k\": " << s.c.k << ", \"density\": " << s.c.density << ", \"matches\": " << s.matches
+            << ", \"reps\": " << s.reps << ", \"mean_us\": " << s.mean_us << ", \"p50_us\": " << s.p50_us
+            << ", \"p99_us\": " << s.p99_us << ", \"throughput_mb_s\": " << s.throughput_mb_s;
+        if (fuzzy::search_stats_enabled)
+        {
+            out << ", \"stats\": {\"bytes_scanned\": " << s.stats.bytes_scanned << ", \"shifts\": " << s.stats.shifts
+                << ", \"shift_length\": " << s.stats.shift_length << ", \"filter_hits\": " << s.stats.filter_hits
+                << ", \"verifications\": " << s.stats.verifications << ", \"verifications_passed\": "
+                << s.stats.verifications_passed << ", \"myers_blocks\": " << s.stats.myers_blocks
+                << ", \"cells\": " << s.stats.cells << "}";
+        }
+        out << "}" << (i + 1 < samples.size() ? "," : "") << '\n';
+    }
+    out << "]\n";
+}
+
+static std::vector<std::string> split(const std::string & list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static std::vector<size_t> split_sizes(const std::string & list)
+{
+    std::vector<size_t> sizes;
+    for (const auto & item : split(list))
+    {
+        sizes.push_back(std::strtoull(item.c_str(), nullptr, 10));
+    }
+    return sizes;
+}
+
+static bool parse_options(int argc, char ** argv, Options & options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string key = argv[i];
+        if (key == "--help" || key == "-h" || i + 1 == argc)
+        {
+            return false;
+        }
+
+        std::string value = argv[++i];
+        if (key == "--sizes")
+            options.sizes = split_sizes(value);
+        else if (key == "--patterns")
+            options.patterns = split_sizes(value);
+        else if (key == "--k")
+            options.ks = split_sizes(value);
+        else if (key == "--alphabets")
+            options.alphabets = split(value);
+        else if (key == "--density")
+            options.densities = split_sizes(value);
+        else if (key == "--engines")
+            options.engines = split(value);
+        else if (key == "--warmup")
+            options.warmup = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--reps")
+            options.reps = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+        else if (key == "--budget")
+            options.budget = std::atof(value.c_str());
+        else if (key == "--seed")
+            options.seed = static_cast<unsigned int>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (key == "--format")
+            options.format = value;
+        else if (key == "--output")
+            options.output = value;
+        else
+            return false;
+    }
+    return options.format == "csv" || options.format == "json";
+}
+
+int main(int argc, char ** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << USAGE;
+        return 1;
+    }
+
+    std::vector<Engine> engines = all_engines();
+    std::vector<Sample> samples;
+
+    // the flasm_hd numbers depend on the kernel picked for this CPU
+    std::cerr << "libflasm SIMD kernel: " << libflasm::flasm_simd_kernel() << '\n';
+
+    for (const auto & alphabet : options.alphabets)
+    for (size_t text_size : options.sizes)
+    for (size_t pattern_length : options.patterns)
+    for (size_t k : options.ks)
+    for (size_t density : options.densities)
+    {
+        BenchmarkCase c = {alphabet, text_size, pattern_length, k, density};
+
+        // every case has its own seed, so it is reproducible on its own
+        std::seed_seq seed = {options.seed, static_cast<unsigned int>(text_size),
+                              static_cast<unsigned int>(pattern_length), static_cast<unsigned int>(k),
+                              static_cast<unsigned int>(density), static_cast<unsigned int>(alphabet.size())};
+        std::mt19937 rng(seed);
+
+        BenchmarkInput input;
+        input.text = generate_text(alphabet, text_size, rng);
+        input.pattern = generate_text(alphabet, pattern_length, rng);
+        plant_matches(input.text, input.pattern, c, rng);
+        input.seqan_text = input.text;
+        input.seqan_pattern = input.pattern;
+
+        for (const auto & engine : engines)
+        {
+            if (std::find(options.engines.begin(), options.engines.end(), engine.name) == options.engines.end() ||
+                pattern_length == 0 || pattern_length > text_size || !engine.supports(c, input))
+            {
+                continue;
+            }
+
+            samples.push_back(measure(engine, c, input, options));
+            std::cerr << engine.name << ' ' << alphabet << " n=" << text_size << " m=" << pattern_length
+                      << " k=" << k << " density=" << density << ": " << samples.back().throughput_mb_s
+                      << " MB/s\n";
+        }
+    }
+
+    std::ofstream file;
+    if (!options.output.empty())
+    {
+        file.open(options.output);
+    }
+    std::ostream & out = options.output.empty() ? std::cout : file;
+
+    if (options.format == "json")
+    {
+        write_json(out, samples);
+    }
+    else
+    {
+        write_csv(out, samples);
+    }
+
+    return 0;
+}
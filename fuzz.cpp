@@ -0,0 +1,1201 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Randl_fuzzy_search.hpp"
+#include "Bitap.hpp"
+#include "libflasm.h"
+#include "FuzzySearcher.hpp"
+
+/**
+ * Differential fuzzer of the search engines against a naive dynamic
+ * programming reference.
+ *
+ * Every input is decoded into a metric, an alphabet, a pattern, k and a text
+ * (see decode()). The occurrences reported by Bitap, fuzzy_search, libflasm,
+ * the SeqAn Myers, MultiPex, pipelined Pex, ABNDM, Horspool, HammingSimple
+ * and HammingShiftAdd finders and FuzzySearcher's automatic plan are compared
+ * with the reference, as are the best scores of myersBatchScores and the
+ * validate_* helpers of fuzzy_search. The top-k results of libflasm must be
+ * the first of all its results, its batch searches must find those of
+ * single searches, and its Hamming kernels for small and large max_error
+ * must agree. fuzzy_search and libflasm are run within
+ * a memory budget as well, which must hold their peak and be released
+ * afterwards. The AhoCorasickDense, MultipleShiftAnd and WuManber dictionary
+ * finders are compared with a naive search for keywords around the pattern
+ * (see dictionary_keywords()). A difference prints the case and aborts.
+ *
+ * Built with -DFUZZY_SEARCH_LIBFUZZER=ON (clang) the program is a libFuzzer
+ * target. Otherwise it generates random inputs with planted, mutated copies
+ * of the pattern, replays inputs given as files (such as libFuzzer crash
+ * files) and reports the time spent in each engine.
+ */
+
+namespace
+{
+
+struct FuzzCase
+{
+    fuzzy::Metric metric;
+    std::string pattern;
+    std::string text;
+    size_t k;
+};
+
+struct Timing
+{
+    unsigned long long calls = 0;
+    double seconds = 0;
+};
+
+std::map<std::string, Timing> timings;
+
+template <typename Function>
+auto timed(const char * engine, Function function) -> decltype(function())
+{
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point started = Clock::now();
+    auto result = function();
+    Timing & timing = timings[engine];
+    timing.calls += 1;
+    timing.seconds += std::chrono::duration<double>(Clock::now() - started).count();
+    return result;
+}
+
+// up to 40 characters for length bytes below 200, and 41 to 261 for the others,
+// which take Myers beyond one machine word
+size_t pattern_length(uint8_t byte)
+{
+    return byte < 200 ? 1 + byte % 40 : 41 + (byte - 200) * 4;
+}
+
+// up to 4 errors, or up to 63 for patterns beyond 40 characters and k bytes of
+// 128 or more, which move the Myers band out of its first block
+size_t error_limit(uint8_t byte, size_t m)
+{
+    return std::min<size_t>(m > 40 && byte >= 128 ? byte % 64 : byte % 5, m - 1);
+}
+
+/**
+ * Input layout: metric, alphabet, pattern length (see pattern_length()) and
+ * k (see error_limit()) bytes, then the pattern and the text. Pattern and
+ * text bytes are taken modulo the alphabet size, so every input is valid and
+ * planted copies survive the mapping.
+ */
+bool decode(const uint8_t * data, size_t size, FuzzCase & c)
+{
+    static const std::string dna = "ACGT";
+    static const std::string letters = "abcdefghijklmnopqrstuvwxyz";
+
+    if (size < 4)
+    {
+        return false;
+    }
+
+    c.metric = data[0] & 1 ? fuzzy::Metric::Levenshtein : fuzzy::Metric::Hamming;
+    const int alphabet = data[1] % 3;
+    const size_t m = pattern_length(data[2]);
+    if (size < 4 + m)
+    {
+        return false;
+    }
+    c.k = error_limit(data[3], m);
+
+    auto symbol = [alphabet](uint8_t byte) {
+        return alphabet == 0 ? dna[byte % dna.size()]
+                             : alphabet == 1 ? letters[byte % letters.size()] : static_cast<char>(byte);
+    };
+    c.pattern.clear();
+    c.text.clear();
+    std::transform(data + 4, data + 4 + m, std::back_inserter(c.pattern), symbol);
+    std::transform(data + 4 + m, data + size, std::back_inserter(c.text), symbol);
+    return true;
+}
+
+// all ends of occurrences with at most k errors and their distance
+std::vector<fuzzy::Match> hamming_reference(const FuzzCase & c)
+{
+    std::vector<fuzzy::Match> matches;
+    const size_t m = c.pattern.size();
+    for (size_t end = m; end <= c.text.size(); ++end)
+    {
+        size_t errors = 0;
+        for (size_t i = 0; i < m; ++i)
+        {
+            errors += c.text[end - m + i] != c.pattern[i];
+        }
+        if (errors <= c.k)
+        {
+            matches.push_back({end, errors});
+        }
+    }
+    return matches;
+}
+
+/**
+ * Semi-global distance of the pattern to a text substring ending at each
+ * text position (entry 0 is the empty prefix), with adjacent transpositions
+ * as one error if damerau is set
+ */
+std::vector<size_t> edit_reference(const FuzzCase & c, bool damerau)
+{
+    const size_t m = c.pattern.size();
+    const size_t n = c.text.size();
+    std::vector<std::vector<size_t>> d(n + 1, std::vector<size_t>(m + 1, 0));
+    for (size_t j = 0; j <= m; ++j)
+    {
+        d[0][j] = j;
+    }
+    for (size_t i = 1; i <= n; ++i)
+    {
+        for (size_t j = 1; j <= m; ++j)
+        {
+            d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1,
+                                d[i - 1][j - 1] + (c.text[i - 1] != c.pattern[j - 1])});
+            if (damerau && i > 1 && j > 1 && c.text[i - 1] == c.pattern[j - 2] && c.text[i - 2] == c.pattern[j - 1])
+            {
+                d[i][j] = std::min(d[i][j], d[i - 2][j - 2] + 1);
+            }
+        }
+    }
+
+    std::vector<size_t> distances(n + 1);
+    for (size_t i = 0; i <= n; ++i)
+    {
+        distances[i] = d[i][m];
+    }
+    return distances;
+}
+
+std::vector<fuzzy::Match> levenshtein_reference(const FuzzCase & c)
+{
+    std::vector<size_t> distances = edit_reference(c, false);
+    std::vector<fuzzy::Match> matches;
+    for (size_t end = 1; end < distances.size(); ++end)
+    {
+        if (distances[end] <= c.k)
+        {
+            matches.push_back({end, distances[end]});
+        }
+    }
+    return matches;
+}
+
+std::string escape(const std::string & s)
+{
+    std::ostringstream out;
+    for (unsigned char ch : s)
+    {
+        if (ch >= 32 && ch < 127 && ch != '\\')
+        {
+            out << ch;
+        }
+        else
+        {
+            char hex[8];
+            std::snprintf(hex, sizeof(hex), "\\x%02x", ch);
+            out << hex;
+        }
+    }
+    return out.str();
+}
+
+std::string describe(const std::vector<fuzzy::Match> & matches)
+{
+    std::ostringstream out;
+    out << matches.size() << " [";
+    for (size_t i = 0; i < matches.size() && i < 16; ++i)
+    {
+        out << (i ? " " : "") << matches[i].end << ':' << matches[i].errors;
+    }
+    out << (matches.size() > 16 ? " ...]" : "]");
+    return out.str();
+}
+
+[[noreturn]] void fail(const FuzzCase & c, const char * engine, const std::string & detail)
+{
+    std::cerr << "mismatch in " << engine << ": " << detail << '\n'
+              << "  metric  " << (c.metric == fuzzy::Metric::Hamming ? "hamming" : "levenshtein") << '\n'
+              << "  k       " << c.k << '\n'
+              << "  pattern \"" << escape(c.pattern) << "\" (" << c.pattern.size() << ")\n"
+              << "  text    \"" << escape(c.text) << "\" (" << c.text.size() << ")\n";
+    std::abort();
+}
+
+void expect_matches(const FuzzCase & c, const char * engine, const std::vector<fuzzy::Match> & found,
+                    const std::vector<fuzzy::Match> & expected)
+{
+    bool same = found.size() == expected.size();
+    for (size_t i = 0; same && i < found.size(); ++i)
+    {
+        same = found[i].end == expected[i].end && found[i].errors == expected[i].errors;
+    }
+    if (!same)
+    {
+        fail(c, engine, "found " + describe(found) + ", expected " + describe(expected));
+    }
+}
+
+template <typename TPattern>
+std::vector<fuzzy::Match> seqan_matches(const FuzzCase & c, TPattern & pattern)
+{
+    std::vector<fuzzy::Match> matches;
+    char * data = const_cast<char *>(c.text.data());
+    libflasm::TextView text(data, data + c.text.size());
+    fuzzy::detail::collect(text, pattern, -static_cast<int>(c.k), matches);
+    return matches;
+}
+
+// the matches of each keyword of a MultiPex dictionary of copies of the pattern
+std::vector<std::vector<fuzzy::Match>> multipex_matches(const FuzzCase & c, size_t copies)
+{
+    seqan::StringSet<seqan::CharString> needles;
+    for (size_t i = 0; i < copies; ++i)
+    {
+        seqan::appendValue(needles, seqan::CharString(c.pattern));
+    }
+    seqan::CharString text = c.text;
+    seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::MultiPex<> > pattern(needles, -static_cast<int>(c.k));
+    seqan::Finder<seqan::CharString> finder(text);
+
+    std::vector<std::vector<fuzzy::Match>> matches(copies);
+    while (seqan::find(finder, pattern))
+    {
+        matches[seqan::position(pattern)].push_back({static_cast<size_t>(seqan::endPosition(finder)),
+                                                     static_cast<size_t>(-seqan::getScore(pattern))});
+    }
+    return matches;
+}
+
+std::vector<fuzzy::Match> flasm_matches(const FuzzCase & c, fuzzy::MemoryBudget * budget = nullptr)
+{
+    unsigned char * t = reinterpret_cast<unsigned char *>(const_cast<char *>(c.text.data()));
+    unsigned char * x = reinterpret_cast<unsigned char *>(const_cast<char *>(c.pattern.data()));
+    const size_t m = c.pattern.size();
+
+    libflasm::ResultTupleSet results;
+    if (budget != nullptr)
+    {
+        results = c.metric == fuzzy::Metric::Hamming
+                ? libflasm::flasm_hd(t, c.text.size(), x, m, m, c.k, true, *budget)
+                : libflasm::flasm_ed(t, c.text.size(), x, m, m, c.k, true, *budget);
+    }
+    else
+    {
+        results = c.metric == fuzzy::Metric::Hamming
+                ? libflasm::flasm_hd(t, c.text.size(), x, m, m, c.k, true)
+                : libflasm::flasm_ed(t, c.text.size(), x, m, m, c.k, true);
+    }
+
+    std::vector<fuzzy::Match> matches;
+    for (const libflasm::ResultTuple & result : results)
+    {
+        matches.push_back({result.pos_t + 1, result.error});
+    }
+    std::sort(matches.begin(), matches.end(), [](const fuzzy::Match & a, const fuzzy::Match & b) { return a.end < b.end; });
+    return matches;
+}
+
+// the starts of all occurrences, restarting bitap after each
+std::vector<size_t> bitap_starts(const FuzzCase & c)
+{
+    std::vector<size_t> starts;
+    auto it = c.text.begin();
+    while (true)
+    {
+        auto result = bitap_fuzzy_bitwise_search_new(it, c.text.end(), c.pattern.begin(), c.pattern.end(), c.k);
+        if (result.first == result.second)
+        {
+            return starts;
+        }
+        starts.push_back(result.first - c.text.begin());
+        it = result.first + 1;
+    }
+}
+
+std::string describe(const libflasm::ResultTupleSet & results)
+{
+    std::ostringstream out;
+    out << results.size() << " results";
+    size_t shown = 0;
+    for (auto it = results.begin(); it != results.end() && shown < 8; ++it, ++shown)
+    {
+        out << (shown == 0 ? ": " : ", ") << it->error << " errors at " << it->pos_t << " of factor " << it->pos_x;
+    }
+    return out.str();
+}
+
+bool same_results(const libflasm::ResultTupleSet & found, const libflasm::ResultTupleSet & expected)
+{
+    bool same = found.size() == expected.size();
+    for (auto f = found.begin(), e = expected.begin(); same && f != found.end(); ++f, ++e)
+    {
+        same = f->pos_t == e->pos_t && f->pos_x == e->pos_x && f->error == e->error;
+    }
+    return same;
+}
+
+/**
+ * The top_k results of the factors of half the pattern must be the first
+ * top_k of all results in ResultTuple order. Small top_k fill the heap early,
+ * so its threshold drops below k and prunes the search.
+ */
+void check_flasm_topk(const FuzzCase & c)
+{
+    unsigned char * t = reinterpret_cast<unsigned char *>(const_cast<char *>(c.text.data()));
+    unsigned char * x = reinterpret_cast<unsigned char *>(const_cast<char *>(c.pattern.data()));
+    const size_t m = c.pattern.size();
+    const size_t factor_length = (m + 1) / 2;
+    const bool hamming = c.metric == fuzzy::Metric::Hamming;
+    const char * engine = hamming ? "flasm_hd_topk" : "flasm_ed_topk";
+
+    const libflasm::ResultTupleSet all = hamming
+            ? libflasm::flasm_hd(t, c.text.size(), x, m, factor_length, c.k, true)
+            : libflasm::flasm_ed(t, c.text.size(), x, m, factor_length, c.k, true);
+    for (size_t top_k : {size_t(0), size_t(1), size_t(2), size_t(5), all.size() / 2, all.size(), all.size() + 1})
+    {
+        const libflasm::ResultTupleSet found = timed(engine, [&]() {
+            return hamming ? libflasm::flasm_hd_topk(t, c.text.size(), x, m, factor_length, c.k, top_k)
+                           : libflasm::flasm_ed_topk(t, c.text.size(), x, m, factor_length, c.k, top_k);
+        });
+        libflasm::ResultTupleSet expected(all.begin(), std::next(all.begin(), std::min(top_k, all.size())));
+        if (!same_results(found, expected))
+        {
+            fail(c, engine, "top " + std::to_string(top_k) + " of factors of " + std::to_string(factor_length) +
+                                    ": found " + describe(found) + ", expected " + describe(expected));
+        }
+    }
+}
+
+/**
+ * The batch searches advance every query through the text in blocks of
+ * BATCH_BLOCK_SIZE characters. Checks them against single searches on a text
+ * of four blocks with a query planted across each block boundary, for factors
+ * of up to a word, more than a word and, for Hamming, more than a byte
+ * counter holds.
+ */
+void check_flasm_batch(std::mt19937 & rng)
+{
+    static const std::string letters = "abcdefghijklmnopqrstuvwxyz";
+    auto random_string = [&](size_t length) {
+        std::string s(length, ' ');
+        for (char & ch : s)
+        {
+            ch = letters[rng() % letters.size()];
+        }
+        return s;
+    };
+
+    // the shortest query has no factors of 8 and more characters
+    const std::vector<std::string> patterns = {random_string(5), random_string(12), random_string(70),
+                                               random_string(320)};
+    FuzzCase c{fuzzy::Metric::Hamming, "", random_string(4 * BATCH_BLOCK_SIZE + 100), 0};
+    for (size_t block = 1; block < 4; ++block)
+    {
+        const std::string & pattern = patterns[block];
+        c.text.replace(block * BATCH_BLOCK_SIZE - pattern.size() / 2, pattern.size(), pattern);
+    }
+
+    unsigned char * t = reinterpret_cast<unsigned char *>(&c.text[0]);
+    std::vector<libflasm::Query> queries;
+    for (const std::string & pattern : patterns)
+    {
+        queries.push_back({reinterpret_cast<unsigned char *>(const_cast<char *>(pattern.data())), pattern.size()});
+    }
+
+    for (fuzzy::Metric metric : {fuzzy::Metric::Hamming, fuzzy::Metric::Levenshtein})
+    {
+        const bool hamming = metric == fuzzy::Metric::Hamming;
+        const char * engine = hamming ? "flasm_hd_batch" : "flasm_ed_batch";
+        c.metric = metric;
+        for (size_t factor_length : {size_t(8), size_t(64), size_t(65), size_t(300)})
+        {
+            for (unsigned int max_error : {0u, 2u})
+            {
+                for (bool return_all : {true, false})
+                {
+                    const libflasm::ResultTupleSets found = timed(engine, [&]() {
+                        return hamming ? libflasm::flasm_hd_batch(t, c.text.size(), queries, factor_length, max_error, return_all)
+                                       : libflasm::flasm_ed_batch(t, c.text.size(), queries, factor_length, max_error, return_all);
+                    });
+                    for (size_t q = 0; q < queries.size(); ++q)
+                    {
+                        const libflasm::Query & query = queries[q];
+                        const libflasm::ResultTupleSet expected = hamming
+                                ? libflasm::flasm_hd(t, c.text.size(), query.x, query.m, factor_length, max_error, return_all)
+                                : libflasm::flasm_ed(t, c.text.size(), query.x, query.m, factor_length, max_error, return_all);
+                        if (!same_results(found[q], expected))
+                        {
+                            c.pattern = patterns[q];
+                            c.k = max_error;
+                            fail(c, engine, "factors of " + std::to_string(factor_length) + (return_all ? ", all" : ", best") +
+                                                    ": found " + describe(found[q]) + ", expected " + describe(expected));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * flasm_hd counts mismatches along diagonals in rings of max_error + 1
+ * entries up to DIAGONAL_MAX_ERROR, and builds error arrays above it. The
+ * SIMD counters take factors of up to a byte, so the factors here are
+ * longer. The results for max_error 0 to DIAGONAL_MAX_ERROR must be those
+ * of the error arrays with one more error, as far as they are within
+ * max_error. The same applies to top-k results, whose threshold shrinks
+ * below the ring.
+ */
+void check_flasm_diagonals(std::mt19937 & rng)
+{
+    static const std::string letters = "abcdefghijklmnopqrstuvwxyz";
+    auto random_letter = [&]() { return letters[rng() % letters.size()]; };
+
+    FuzzCase c{fuzzy::Metric::Hamming, std::string(400, ' '), std::string(6000, ' '), 0};
+    std::generate(c.pattern.begin(), c.pattern.end(), random_letter);
+    std::generate(c.text.begin(), c.text.end(), random_letter);
+    for (size_t copy = 0; copy < 14; ++copy)
+    {
+        std::string planted = c.pattern;
+        for (size_t e = 0; e < copy % (DIAGONAL_MAX_ERROR + 3); ++e)
+        {
+            planted[rng() % planted.size()] = random_letter();
+        }
+        c.text.replace(rng() % (c.text.size() - planted.size() + 1), planted.size(), planted);
+    }
+
+    unsigned char * t = reinterpret_cast<unsigned char *>(&c.text[0]);
+    unsigned char * x = reinterpret_cast<unsigned char *>(&c.pattern[0]);
+    const size_t n = c.text.size();
+    const size_t m = c.pattern.size();
+    for (size_t factor_length : {size_t(20), size_t(256), size_t(300), m})
+    {
+        const std::string factors = "factors of " + std::to_string(factor_length);
+        const libflasm::ResultTupleSet arrays = libflasm::flasm_hd(t, n, x, m, factor_length, DIAGONAL_MAX_ERROR + 1, true);
+        for (unsigned int max_error = 0; max_error <= DIAGONAL_MAX_ERROR; ++max_error)
+        {
+            c.k = max_error;
+            libflasm::ResultTupleSet expected;
+            for (const libflasm::ResultTuple & result : arrays)
+            {
+                if (result.error <= max_error)
+                {
+                    expected.insert(result);
+                }
+            }
+
+            const libflasm::ResultTupleSet all = timed("flasm_hd_diagonals", [&]() {
+                return libflasm::flasm_hd(t, n, x, m, factor_length, max_error, true);
+            });
+            if (!same_results(all, expected))
+            {
+                fail(c, "flasm_hd_diagonals", factors + ": found " + describe(all) + ", expected " + describe(expected));
+            }
+
+            // the first of them in the order of the sequential scan
+            const libflasm::ResultTupleSet best = libflasm::flasm_hd(t, n, x, m, factor_length, max_error, false);
+            auto first = std::min_element(expected.begin(), expected.end(), [](const libflasm::ResultTuple & a,
+                                                                              const libflasm::ResultTuple & b) {
+                return a.error != b.error ? a.error < b.error : a.pos_x != b.pos_x ? a.pos_x < b.pos_x : a.pos_t < b.pos_t;
+            });
+            const libflasm::ResultTupleSet expected_best(first, first == expected.end() ? first : std::next(first));
+            if (!same_results(best, expected_best))
+            {
+                fail(c, "flasm_hd_diagonals", factors + ", best: found " + describe(best) + ", expected " +
+                                                      describe(expected_best));
+            }
+
+            for (size_t top_k : {size_t(1), size_t(3), expected.size() / 2})
+            {
+                const libflasm::ResultTupleSet found = libflasm::flasm_hd_topk(t, n, x, m, factor_length, max_error, top_k);
+                const libflasm::ResultTupleSet expected_top(expected.begin(),
+                                                            std::next(expected.begin(), std::min(top_k, expected.size())));
+                if (!same_results(found, expected_top))
+                {
+                    fail(c, "flasm_hd_diagonals", factors + ", top " + std::to_string(top_k) + ": found " +
+                                                          describe(found) + ", expected " + describe(expected_top));
+                }
+            }
+        }
+    }
+}
+
+// leaves fuzzy_search a reduced alphabet of two or three symbols
+const size_t RANDL_BUDGET = 64 << 10;
+
+// holds the matches of the largest inputs
+const size_t FLASM_BUDGET = 4 << 20;
+
+// runs function(budget) with a budget of limit bytes, which must hold its peak and be released afterwards
+template <typename Function>
+auto within_budget(const FuzzCase & c, const char * engine, size_t limit, Function function)
+        -> decltype(function(std::declval<fuzzy::MemoryBudget &>()))
+{
+    fuzzy::MemoryBudget budget(limit);
+    auto result = timed(engine, [&]() { return function(budget); });
+    if (budget.in_use() != 0 || budget.peak() > limit)
+    {
+        fail(c, engine, "budget of " + std::to_string(limit) + " bytes ended with " +
+                                std::to_string(budget.in_use()) + " in use, peak " + std::to_string(budget.peak()));
+    }
+    return result;
+}
+
+// fuzzy_search enumerates every q-gram over its reduced alphabet, keep that small
+bool randl_affordable(const FuzzCase & c)
+{
+    std::vector<bool> in_pattern(256, false);
+    for (unsigned char ch : c.pattern)
+    {
+        in_pattern[ch] = true;
+    }
+    std::vector<bool> seen(256, false);
+    size_t symbols = 0;
+    bool other = false;
+    for (unsigned char ch : c.text)
+    {
+        other = other || !in_pattern[ch];
+        symbols += in_pattern[ch] && !seen[ch];
+        seen[ch] = true;
+    }
+    return symbols + other <= 6;
+}
+
+void check_hamming(const FuzzCase & c)
+{
+    const std::vector<fuzzy::Match> expected = hamming_reference(c);
+    const size_t m = c.pattern.size();
+
+    expect_matches(c, "flasm_hd", timed("flasm_hd", [&]() { return flasm_matches(c); }), expected);
+    expect_matches(c, "flasm_hd_budget", within_budget(c, "flasm_hd_budget", FLASM_BUDGET, [&](fuzzy::MemoryBudget & budget) {
+                       return flasm_matches(c, &budget);
+                   }), expected);
+
+    seqan::CharString needle = c.pattern;
+    expect_matches(c, "seqan_hamming", timed("seqan_hamming", [&]() {
+                       seqan::Pattern<seqan::CharString, seqan::HammingSimple> pattern(needle);
+                       return seqan_matches(c, pattern);
+                   }), expected);
+    expect_matches(c, "seqan_shiftadd", timed("seqan_shiftadd", [&]() {
+                       seqan::Pattern<seqan::CharString, seqan::HammingShiftAdd> pattern(needle);
+                       return seqan_matches(c, pattern);
+                   }), expected);
+
+    if (c.k == 0)
+    {
+        expect_matches(c, "seqan_horspool", timed("seqan_horspool", [&]() {
+                           seqan::Pattern<seqan::CharString, seqan::Horspool> pattern(needle);
+                           char * data = const_cast<char *>(c.text.data());
+                           libflasm::TextView text(data, data + c.text.size());
+                           seqan::Finder<libflasm::TextView> finder(text);
+                           std::vector<fuzzy::Match> matches;
+                           while (seqan::find(finder, pattern))
+                           {
+                               matches.push_back({static_cast<size_t>(seqan::endPosition(finder)), 0});
+                           }
+                           return matches;
+                       }), expected);
+    }
+
+    expect_matches(c, "auto_hd", timed("auto_hd", [&]() {
+                       return fuzzy::FuzzySearcher(fuzzy::Metric::Hamming).search(c.text, c.pattern, c.k);
+                   }), expected);
+
+    if (m <= 31)
+    {
+        std::vector<size_t> starts = timed("bitap", [&]() { return bitap_starts(c); });
+        std::vector<fuzzy::Match> found;
+        for (size_t start : starts)
+        {
+            found.push_back({start + m, fuzzy::detail::hamming(c.text.data(), start, c.pattern)});
+        }
+        expect_matches(c, "bitap", found, expected);
+    }
+
+    if (fuzzy::detail::randl_supported(c.pattern, c.k, c.metric))
+    {
+        size_t leftmost = expected.empty() ? c.text.size() : expected.front().end - m;
+        if (randl_affordable(c))
+        {
+            auto it = timed("randl_hd", [&]() {
+                return fuzzy_search(c.text.begin(), c.text.end(), c.pattern.begin(), c.pattern.end(), c.k, true);
+            });
+            size_t found = it - c.text.begin();
+            if (found != leftmost)
+            {
+                fail(c, "randl_hd", "returned " + std::to_string(found) + ", expected " + std::to_string(leftmost));
+            }
+        }
+
+        auto it = within_budget(c, "randl_hd_budget", RANDL_BUDGET, [&](fuzzy::MemoryBudget & budget) {
+            return fuzzy_search(c.text.begin(), c.text.end(), c.pattern.begin(), c.pattern.end(), c.k, true, budget);
+        });
+        size_t found = it - c.text.begin();
+        if (found != leftmost)
+        {
+            fail(c, "randl_hd_budget", "returned " + std::to_string(found) + ", expected " + std::to_string(leftmost));
+        }
+    }
+
+    for (size_t end = m; end <= c.text.size(); ++end)
+    {
+        bool valid = validate_hamming(c.text.begin() + (end - m), c.pattern.begin(), c.k, m);
+        bool match = std::any_of(expected.begin(), expected.end(), [end](const fuzzy::Match & e) { return e.end == end; });
+        if (valid != match)
+        {
+            fail(c, "validate_hamming", "window ending at " + std::to_string(end));
+        }
+    }
+}
+
+void check_levenshtein(const FuzzCase & c)
+{
+    const std::vector<fuzzy::Match> expected = levenshtein_reference(c);
+    const size_t m = c.pattern.size();
+
+    expect_matches(c, "flasm_ed", timed("flasm_ed", [&]() { return flasm_matches(c); }), expected);
+    expect_matches(c, "flasm_ed_budget", within_budget(c, "flasm_ed_budget", FLASM_BUDGET, [&](fuzzy::MemoryBudget & budget) {
+                       return flasm_matches(c, &budget);
+                   }), expected);
+
+    seqan::CharString needle = c.pattern;
+    expect_matches(c, "seqan_myers", timed("seqan_myers", [&]() {
+                       seqan::Pattern<seqan::CharString, seqan::Myers<> > pattern(needle);
+                       return seqan_matches(c, pattern);
+                   }), expected);
+
+    // the best occurrence in prefixes of the text, a batch large enough to refill lanes
+    {
+        const size_t copies = 24;
+        seqan::StringSet<seqan::CharString> needles, haystacks;
+        for (size_t i = 0; i < copies; ++i)
+        {
+            seqan::appendValue(needles, needle);
+            seqan::appendValue(haystacks, seqan::CharString(c.text.substr(0, c.text.size() * i / (copies - 1))));
+        }
+        seqan::String<int> scores;
+        seqan::String<size_t> ends;
+        timed("seqan_myers_batch", [&]() {
+            seqan::myersBatchScores(scores, ends, needles, haystacks);
+            return 0;
+        });
+        for (size_t i = 0; i < copies; ++i)
+        {
+            const size_t n = seqan::length(haystacks[i]);
+            const fuzzy::Match * best = nullptr;
+            for (const fuzzy::Match & e : expected)
+            {
+                if (e.end <= n && (best == nullptr || e.errors < best->errors))
+                {
+                    best = &e;
+                }
+            }
+            // an empty prefix has no end position, its score is the length of the pattern
+            const size_t errors = -scores[i];
+            if (best != nullptr ? errors != best->errors || ends[i] != best->end : n != 0 && errors <= c.k)
+            {
+                fail(c, "seqan_myers_batch", "prefix of " + std::to_string(n) + ": best " + std::to_string(errors) +
+                     " errors ending at " + std::to_string(ends[i]));
+            }
+        }
+    }
+
+    // keywords of at most k characters are not searched by the filter
+    if (m > c.k)
+    {
+        const std::vector<std::vector<fuzzy::Match>> dictionary =
+                timed("seqan_multipex", [&]() { return multipex_matches(c, 2); });
+        expect_matches(c, "seqan_multipex", dictionary[0], expected);
+        expect_matches(c, "seqan_multipex", dictionary[1], expected);
+
+        // with worker threads even on a single core, so the queue is exercised, and
+        // in about three rounds, so occurrences are held back across them
+        expect_matches(c, "seqan_pex_pipelined", timed("seqan_pex_pipelined", [&]() {
+                           seqan::CharString text = c.text;
+                           seqan::Pattern<seqan::CharString, seqan::PexPipelined> pattern(needle, -static_cast<int>(c.k));
+                           seqan::setVerificationThreads(pattern, 3);
+                           seqan::setRoundLength(pattern, 1 + c.text.size() / 3);
+                           std::vector<fuzzy::Match> matches;
+                           fuzzy::detail::collect(text, pattern, matches);
+                           return matches;
+                       }), expected);
+    }
+
+    // the facade must refuse ABNDM for patterns of k + 1 characters, on which the filter does not terminate
+    const fuzzy::FuzzySearcher abndm(fuzzy::Metric::Levenshtein, fuzzy::Engine::Abndm);
+    const fuzzy::Plan abndm_plan = abndm.plan(c.text, c.pattern, c.k);
+    if (abndm_plan.supported && m <= c.k + 1)
+    {
+        fail(c, "seqan_abndm", "planned for a pattern of at most k + 1 characters");
+    }
+    if (abndm_plan.supported)
+    {
+        expect_matches(c, "seqan_abndm", timed("seqan_abndm", [&]() { return abndm.search(c.text, c.pattern, c.k); }),
+                       expected);
+    }
+    expect_matches(c, "auto_ed", timed("auto_ed", [&]() {
+                       return fuzzy::FuzzySearcher(fuzzy::Metric::Levenshtein).search(c.text, c.pattern, c.k);
+                   }), expected);
+
+    if (fuzzy::detail::randl_supported(c.pattern, c.k, c.metric))
+    {
+        size_t window = expected.empty() ? c.text.size() : expected.front().end - std::min(expected.front().end, m + c.k);
+        if (randl_affordable(c))
+        {
+            auto it = timed("randl_ed", [&]() {
+                return fuzzy_search(c.text.begin(), c.text.end(), c.pattern.begin(), c.pattern.end(), c.k, false);
+            });
+            size_t found = it - c.text.begin();
+            if (found != window)
+            {
+                fail(c, "randl_ed", "returned " + std::to_string(found) + ", expected " + std::to_string(window));
+            }
+        }
+
+        auto it = within_budget(c, "randl_ed_budget", RANDL_BUDGET, [&](fuzzy::MemoryBudget & budget) {
+            return fuzzy_search(c.text.begin(), c.text.end(), c.pattern.begin(), c.pattern.end(), c.k, false, budget);
+        });
+        size_t found = it - c.text.begin();
+        if (found != window)
+        {
+            fail(c, "randl_ed_budget", "returned " + std::to_string(found) + ", expected " + std::to_string(window));
+        }
+    }
+
+    // the validators look at the m + k characters before an end, or fewer at the start of the text
+    const std::vector<size_t> distances = edit_reference(c, false);
+    const std::vector<size_t> damerau = edit_reference(c, true);
+    for (size_t end = 1; end <= c.text.size(); ++end)
+    {
+        size_t window = std::min(end, m + c.k);
+        auto first = c.text.begin() + (end - window);
+        if (validate_levenshtein(first, c.pattern.begin(), c.k, m, window) != (distances[end] <= c.k))
+        {
+            fail(c, "validate_levenshtein", "window ending at " + std::to_string(end));
+        }
+        if (validate_damerau_levenshtein(first, c.pattern.begin(), c.k, m, window) != (damerau[end] <= c.k))
+        {
+            fail(c, "validate_damerau_levenshtein", "window ending at " + std::to_string(end));
+        }
+    }
+}
+
+// the (end, keyword) pairs of all occurrences of the nonempty keywords
+typedef std::vector<std::pair<size_t, size_t>> KeywordMatches;
+
+// keywords around the case: the pattern twice, an infix of it, which is empty for a single character, and two
+// infixes of the text, which occur at least once
+std::vector<std::string> dictionary_keywords(const FuzzCase & c)
+{
+    const size_t m = c.pattern.size();
+    return {c.pattern, c.pattern.substr(m / 3, m / 2), c.text.substr(c.text.size() / 3, m), c.pattern,
+            c.text.substr(c.text.size() / 2, c.k + 1)};
+}
+
+KeywordMatches dictionary_reference(const std::string & text, const std::vector<std::string> & keywords)
+{
+    KeywordMatches matches;
+    for (size_t i = 0; i < keywords.size(); ++i)
+    {
+        const std::string & keyword = keywords[i];
+        for (size_t end = keyword.size(); !keyword.empty() && end <= text.size(); ++end)
+        {
+            if (text.compare(end - keyword.size(), keyword.size(), keyword) == 0)
+            {
+                matches.push_back({end, i});
+            }
+        }
+    }
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+template <typename TPattern>
+KeywordMatches dictionary_matches(const std::string & text, TPattern & pattern)
+{
+    seqan::CharString haystack = text;
+    seqan::Finder<seqan::CharString> finder(haystack);
+    KeywordMatches matches;
+    while (seqan::find(finder, pattern))
+    {
+        matches.push_back({static_cast<size_t>(seqan::endPosition(finder)), static_cast<size_t>(seqan::position(pattern))});
+    }
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+seqan::StringSet<seqan::CharString> dictionary_needles(const std::vector<std::string> & keywords)
+{
+    seqan::StringSet<seqan::CharString> needles;
+    for (const std::string & keyword : keywords)
+    {
+        seqan::appendValue(needles, seqan::CharString(keyword));
+    }
+    return needles;
+}
+
+std::string describe(const KeywordMatches & matches)
+{
+    std::ostringstream out;
+    out << matches.size() << " matches";
+    for (size_t i = 0; i < matches.size() && i < 8; ++i)
+    {
+        out << (i == 0 ? ": " : ", ") << "keyword " << matches[i].second << " ending at " << matches[i].first;
+    }
+    return out.str();
+}
+
+void expect_keyword_matches(const FuzzCase & c, const char * engine, const KeywordMatches & found,
+                            const KeywordMatches & expected)
+{
+    if (found != expected)
+    {
+        fail(c, engine, "found " + describe(found) + ", expected " + describe(expected));
+    }
+}
+
+// exact multi-pattern search of the dictionary_keywords() of the case
+void check_dictionary(const FuzzCase & c)
+{
+    const std::vector<std::string> keywords = dictionary_keywords(c);
+    const KeywordMatches expected = dictionary_reference(c.text, keywords);
+    const seqan::StringSet<seqan::CharString> needles = dictionary_needles(keywords);
+
+    expect_keyword_matches(c, "seqan_ahocorasick_dense", timed("seqan_ahocorasick_dense", [&]() {
+                               seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::AhoCorasickDense> pattern(needles);
+                               return dictionary_matches(c.text, pattern);
+                           }), expected);
+
+    // one word, two vectors held in registers, and eight copies of the keywords beyond them in memory
+    expect_keyword_matches(c, "seqan_multiple_shiftand", timed("seqan_multiple_shiftand", [&]() {
+                               seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::MultipleShiftAnd> pattern(needles);
+                               return dictionary_matches(c.text, pattern);
+                           }), expected);
+    std::vector<std::string> copies;
+    for (int i = 0; i < 8; ++i)
+    {
+        copies.insert(copies.end(), keywords.begin(), keywords.end());
+    }
+    expect_keyword_matches(c, "seqan_multiple_shiftand", timed("seqan_multiple_shiftand", [&]() {
+                               seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::MultipleShiftAnd> pattern(
+                                       dictionary_needles(copies));
+                               return dictionary_matches(c.text, pattern);
+                           }), dictionary_reference(c.text, copies));
+
+    expect_keyword_matches(c, "seqan_wumanber", timed("seqan_wumanber", [&]() {
+                               seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::WuManber> pattern(needles);
+                               return dictionary_matches(c.text, pattern);
+                           }), expected);
+}
+
+/**
+ * WuManber hashes four values for dictionaries of more than 5 bits per value
+ * with lmin >= 8 and lmin * keywords >= 1536. Checks such a dictionary of
+ * random bytes, with duplicates and keywords that extend others, on a text
+ * with planted keywords.
+ */
+void check_wumanber_q4(std::mt19937 & rng)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<std::string> keywords;
+    while (keywords.size() < 1600)
+    {
+        const size_t choice = rng() % 16;
+        if (choice == 0 && !keywords.empty())
+        {
+            keywords.push_back(keywords[rng() % keywords.size()]);
+        }
+        else if (choice == 1 && !keywords.empty())
+        {
+            keywords.push_back(keywords[rng() % keywords.size()] + static_cast<char>(byte(rng)));
+        }
+        else
+        {
+            std::string keyword(8 + rng() % 13, ' ');
+            for (char & ch : keyword)
+            {
+                ch = static_cast<char>(byte(rng));
+            }
+            keywords.push_back(keyword);
+        }
+    }
+
+    FuzzCase c{fuzzy::Metric::Hamming, "", std::string(1 << 14, ' '), 0};
+    for (char & ch : c.text)
+    {
+        ch = static_cast<char>(byte(rng));
+    }
+    for (int i = 0; i < 400; ++i)
+    {
+        const std::string & keyword = keywords[rng() % keywords.size()];
+        c.text.replace(rng() % (c.text.size() - keyword.size() + 1), keyword.size(), keyword);
+    }
+
+    seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::WuManber> pattern(dictionary_needles(keywords));
+    if (pattern.q != 4)
+    {
+        fail(c, "seqan_wumanber", "hashed " + std::to_string(pattern.q) + " values instead of 4");
+    }
+    expect_keyword_matches(c, "seqan_wumanber", timed("seqan_wumanber", [&]() {
+                               return dictionary_matches(c.text, pattern);
+                           }), dictionary_reference(c.text, keywords));
+}
+
+/**
+ * The dense Aho-Corasick table addresses its rows by 31 bits. A dictionary of
+ * exactly 2^24 trie nodes over 128 character classes must be refused, while
+ * duplicates with too many characters for the table but a small trie must be
+ * searched.
+ */
+void check_dense_table_limit()
+{
+    std::string alphabet;
+    for (int ch = 1; ch < 128; ++ch)
+    {
+        alphabet.push_back(static_cast<char>(ch));
+    }
+
+    // the root, 127 nodes of the alphabet and those of a keyword beginning with another character
+    std::string chain((size_t(1) << 24) - 128, ' ');
+    for (size_t i = 0; i < chain.size(); ++i)
+    {
+        chain[i] = alphabet[(i + 1) % alphabet.size()];
+    }
+    const FuzzCase limit{fuzzy::Metric::Hamming, alphabet, chain, 0};
+    bool refused = false;
+    try
+    {
+        seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::AhoCorasickDense> pattern(
+                dictionary_needles({alphabet, chain}));
+    }
+    catch (const seqan::RuntimeError &)
+    {
+        refused = true;
+    }
+    if (!refused)
+    {
+        fail(limit, "seqan_ahocorasick_dense", "built a table of 2^31 entries");
+    }
+
+    const size_t copies = 132200;
+    const FuzzCase duplicates{fuzzy::Metric::Hamming, alphabet, alphabet + alphabet, 0};
+    seqan::Pattern<seqan::StringSet<seqan::CharString>, seqan::AhoCorasickDense> pattern(
+            dictionary_needles(std::vector<std::string>(copies, alphabet)));
+    const KeywordMatches found = dictionary_matches(duplicates.text, pattern);
+    bool same = found.size() == 2 * copies;
+    for (size_t i = 0; same && i < found.size(); ++i)
+    {
+        same = found[i].first == (1 + i / copies) * alphabet.size() && found[i].second == i % copies;
+    }
+    if (!same)
+    {
+        fail(duplicates, "seqan_ahocorasick_dense", "found " + describe(found) + " of " + std::to_string(copies) +
+                                                            " duplicates");
+    }
+}
+
+void check(const FuzzCase & c)
+{
+    if (c.pattern.size() > c.text.size())
+    {
+        return;
+    }
+    if (c.metric == fuzzy::Metric::Hamming)
+    {
+        check_hamming(c);
+    }
+    else
+    {
+        check_levenshtein(c);
+    }
+    check_flasm_topk(c);
+    check_dictionary(c);
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t * data, size_t size)
+{
+    FuzzCase c;
+    if (decode(data, size, c))
+    {
+        check(c);
+    }
+    return 0;
+}
+
+#ifndef FUZZY_SEARCH_LIBFUZZER
+
+namespace
+{
+
+struct Options
+{
+    size_t iterations = 10000;
+    size_t max_text = 256;
+    unsigned int seed = 42;
+    std::vector<std::string> files;
+};
+
+const char * const USAGE =
+        "usage: FuzzySearchFuzz [--iterations N] [--max-text N] [--seed S] [FILE..]\n"
+        "\n"
+        "Without files, checks N random cases with texts of up to max-text characters,\n"
+        "or twice the pattern length if that is longer.\n"
+        "With files, replays each of them as one input (for example libFuzzer crash files).\n";
+
+bool parse_options(int argc, char ** argv, Options & options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string key = argv[i];
+        if (key.compare(0, 2, "--") != 0)
+        {
+            options.files.push_back(key);
+            continue;
+        }
+        if (key == "--help" || i + 1 == argc)
+        {
+            return false;
+        }
+
+        std::string value = argv[++i];
+        if (key == "--iterations")
+            options.iterations = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--max-text")
+            options.max_text = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "--seed")
+            options.seed = static_cast<unsigned int>(std::strtoul(value.c_str(), nullptr, 10));
+        else
+            return false;
+    }
+    return true;
+}
+
+/**
+ * A random input in the layout of decode(), with up to three copies of the
+ * pattern planted into the text and changed by up to k + 1 edits each
+ */
+std::vector<uint8_t> generate_input(std::mt19937 & rng, size_t max_text)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<uint8_t> input;
+    for (int i = 0; i < 4; ++i)
+    {
+        input.push_back(static_cast<uint8_t>(byte(rng)));
+    }
+
+    const size_t m = pattern_length(input[2]);
+    const size_t k = error_limit(input[3], m);
+    std::vector<uint8_t> pattern(m);
+    for (auto & b : pattern)
+    {
+        b = static_cast<uint8_t>(byte(rng));
+    }
+
+    std::vector<uint8_t> text(std::uniform_int_distribution<size_t>(0, std::max(max_text, 2 * m))(rng));
+    for (auto & b : text)
+    {
+        b = static_cast<uint8_t>(byte(rng));
+    }
+
+    const size_t copies = text.size() >= m ? rng() % 4 : 0;
+    for (size_t i = 0; i < copies; ++i)
+    {
+        std::vector<uint8_t> copy = pattern;
+        for (size_t e = rng() % (k + 2); e > 0 && !copy.empty(); --e)
+        {
+            size_t at = rng() % copy.size();
+            switch (rng() % 3)
+            {
+                case 0: copy[at] = static_cast<uint8_t>(byte(rng)); break;
+                case 1: copy.insert(copy.begin() + at, static_cast<uint8_t>(byte(rng))); break;
+                default: copy.erase(copy.begin() + at); break;
+            }
+        }
+        if (copy.size() <= text.size())
+        {
+            std::copy(copy.begin(), copy.end(), text.begin() + rng() % (text.size() - copy.size() + 1));
+        }
+    }
+
+    input.insert(input.end(), pattern.begin(), pattern.end());
+    input.insert(input.end(), text.begin(), text.end());
+    return input;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        std::cerr << USAGE;
+        return 1;
+    }
+
+    // patterns of k + 1 characters, on which ABNDM does not terminate
+    size_t cases = 0;
+    for (size_t k = 0; k < 3; ++k)
+    {
+        check({fuzzy::Metric::Levenshtein, std::string("abc", k + 1), "abracadabra, abc and cab", k});
+        ++cases;
+    }
+    check_dense_table_limit();
+    ++cases;
+
+    if (!options.files.empty())
+    {
+        for (const auto & name : options.files)
+        {
+            std::ifstream file(name, std::ios::binary);
+            if (!file)
+            {
+                std::cerr << "FuzzySearchFuzz: cannot open " << name << '\n';
+                return 1;
+            }
+            std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+            ++cases;
+        }
+    }
+    else
+    {
+        std::mt19937 rng(options.seed);
+        check_wumanber_q4(rng);
+        check_flasm_batch(rng);
+        check_flasm_diagonals(rng);
+        cases += 3;
+        for (size_t i = 0; i < options.iterations; ++i)
+        {
+            std::vector<uint8_t> input = generate_input(rng, options.max_text);
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+            ++cases;
+        }
+    }
+
+    std::cerr << cases << " cases, no mismatches (libflasm SIMD kernel: " << libflasm::flasm_simd_kernel() << ")\n";
+    std::cout << "engine,calls,total_ms,mean_us\n";
+    for (const auto & entry : timings)
+    {
+        const Timing & timing = entry.second;
+        std::cout << entry.first << ',' << timing.calls << ',' << timing.seconds * 1e3 << ','
+                  << timing.seconds * 1e6 / timing.calls << '\n';
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,388 @@
+#ifndef FUZZY_SEARCH_MEMORY_H
+#define FUZZY_SEARCH_MEMORY_H
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+/**
+ * Memory accounting and limits per query.
+ *
+ * A MemoryBudget passes allocations on to an upstream MemoryResource (plain
+ * operator new by default, or any resource the caller plugs in) while it
+ * tracks the bytes in use and their peak. Once an allocation would take the
+ * bytes in use over the limit it throws BudgetExceeded instead.
+ *
+ * The budget-aware engines (fuzzy_search, libflasm::flasm_hd and flasm_ed,
+ * FuzzySearcher) allocate their tables through a ResourceAllocator, or charge()
+ * buffers they allocate otherwise, and check fits() before choosing a
+ * strategy: they degrade to a streaming one when the regular one would not
+ * fit, and refuse the query with BudgetExceeded when neither does.
+ *
+ *     fuzzy::MemoryBudget budget(64 << 20);
+ *     auto it = fuzzy_search(first, last, s_first, s_last, k, true, budget);
+ *     size_t peak = budget.peak();
+ *
+ * The short-lived buffers of the engines (Bitap's state, the rows of the
+ * validators and of libflasm, fuzzy_search's tables) come from
+ * query_resource(): a per-thread ArenaResource while an ArenaScope is open on
+ * the thread, operator new otherwise. FuzzySearcher::search opens a scope per
+ * query and the engines open nested ones, so a query allocates from chunks the
+ * thread keeps rather than from the shared heap, and everything it allocated
+ * is released at once when its scope closes. A container taken from
+ * query_resource() must not outlive, or grow outside of, the scope it was
+ * created in.
+ */
+
+namespace fuzzy
+{
+
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource() = default;
+
+    virtual void * allocate(size_t bytes) = 0;
+
+    virtual void deallocate(void * pointer, size_t bytes) = 0;
+};
+
+// the global operator new and delete
+class NewDeleteResource : public MemoryResource
+{
+public:
+    void * allocate(size_t bytes) override
+    {
+        return ::operator new(bytes);
+    }
+
+    void deallocate(void * pointer, size_t) override
+    {
+        ::operator delete(pointer);
+    }
+};
+
+inline MemoryResource & new_delete_resource()
+{
+    static NewDeleteResource resource;
+    return resource;
+}
+
+class BudgetExceeded : public std::bad_alloc
+{
+public:
+    const char * what() const noexcept override
+    {
+        return "fuzzy search memory budget exceeded";
+    }
+};
+
+class MemoryBudget : public MemoryResource
+{
+public:
+    static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+    // an UNLIMITED budget only measures the peak
+    explicit MemoryBudget(size_t limit = UNLIMITED, MemoryResource & upstream = new_delete_resource())
+        : limit_(limit), upstream_(upstream)
+    {}
+
+    MemoryBudget(const MemoryBudget &) = delete;
+    MemoryBudget & operator=(const MemoryBudget &) = delete;
+
+    size_t limit() const { return limit_; }
+
+    size_t in_use() const { return in_use_; }
+
+    size_t peak() const { return peak_; }
+
+    size_t remaining() const { return limit_ - in_use_; }
+
+    bool fits(size_t bytes) const { return bytes <= remaining(); }
+
+    // accounts for memory allocated elsewhere, throws BudgetExceeded if it does not fit
+    void charge(size_t bytes)
+    {
+        if (!fits(bytes))
+        {
+            throw BudgetExceeded();
+        }
+        in_use_ += bytes;
+        peak_ = in_use_ > peak_ ? in_use_ : peak_;
+    }
+
+    void release(size_t bytes)
+    {
+        in_use_ -= bytes < in_use_ ? bytes : in_use_;
+    }
+
+    void * allocate(size_t bytes) override
+    {
+        charge(bytes);
+        try
+        {
+            return upstream_.allocate(bytes);
+        }
+        catch (...)
+        {
+            release(bytes);
+            throw;
+        }
+    }
+
+    void deallocate(void * pointer, size_t bytes) override
+    {
+        upstream_.deallocate(pointer, bytes);
+        release(bytes);
+    }
+
+private:
+    size_t limit_;
+    size_t in_use_ = 0;
+    size_t peak_ = 0;
+    MemoryResource & upstream_;
+};
+
+/**
+ * Charges bytes to a budget for the lifetime of a buffer that is not
+ * allocated through it; does nothing without a budget
+ */
+class BudgetCharge
+{
+public:
+    BudgetCharge(MemoryBudget * budget, size_t bytes) : budget_(budget), bytes_(bytes)
+    {
+        if (budget_ != nullptr)
+        {
+            budget_->charge(bytes_);
+        }
+    }
+
+    BudgetCharge(const BudgetCharge &) = delete;
+    BudgetCharge & operator=(const BudgetCharge &) = delete;
+
+    ~BudgetCharge()
+    {
+        if (budget_ != nullptr)
+        {
+            budget_->release(bytes_);
+        }
+    }
+
+private:
+    MemoryBudget * budget_;
+    size_t bytes_;
+};
+
+/**
+ * Bump allocator over chunks of an upstream resource. deallocate() does
+ * nothing; memory is released by rewinding to a mark(), which keeps up to
+ * RETAINED bytes of chunks for reuse, so a thread that runs query after query
+ * stops calling the upstream resource once warm.
+ */
+class ArenaResource : public MemoryResource
+{
+public:
+    static constexpr size_t CHUNK = 64 << 10;
+    static constexpr size_t RETAINED = 4 << 20;
+
+    // the position of the next allocation
+    struct Mark
+    {
+        size_t chunk;
+        size_t offset;
+    };
+
+    explicit ArenaResource(MemoryResource & upstream = new_delete_resource()) : upstream_(upstream)
+    {}
+
+    ArenaResource(const ArenaResource &) = delete;
+    ArenaResource & operator=(const ArenaResource &) = delete;
+
+    ~ArenaResource()
+    {
+        release(0);
+    }
+
+    void * allocate(size_t bytes) override
+    {
+        const size_t align = alignof(std::max_align_t);
+        bytes = (bytes + align - 1) / align * align;
+        while (current_ < chunks_.size())
+        {
+            Chunk & chunk = chunks_[current_];
+            if (bytes <= chunk.size - offset_)
+            {
+                void * pointer = chunk.data + offset_;
+                offset_ += bytes;
+                return pointer;
+            }
+            ++current_;
+            offset_ = 0;
+        }
+
+        // past the last chunk, a new one is appended
+        const size_t size = bytes > CHUNK ? bytes : CHUNK;
+        chunks_.push_back({static_cast<char *>(upstream_.allocate(size)), size});
+        current_ = chunks_.size() - 1;
+        offset_ = bytes;
+        return chunks_.back().data;
+    }
+
+    void deallocate(void *, size_t) override
+    {}
+
+    Mark mark() const
+    {
+        return {current_, offset_};
+    }
+
+    // releases everything allocated since mark was taken
+    void rewind(Mark mark)
+    {
+        current_ = mark.chunk;
+        offset_ = mark.offset;
+
+        // keep the chunks up to the mark and RETAINED bytes of empty ones after it
+        size_t keep = current_ + 1, retained = 0;
+        while (keep < chunks_.size() && retained + chunks_[keep].size <= RETAINED)
+        {
+            retained += chunks_[keep++].size;
+        }
+        release(keep);
+    }
+
+    void reset()
+    {
+        rewind({0, 0});
+    }
+
+    // bytes held from the upstream resource
+    size_t capacity() const
+    {
+        size_t bytes = 0;
+        for (const Chunk & chunk : chunks_)
+        {
+            bytes += chunk.size;
+        }
+        return bytes;
+    }
+
+private:
+    struct Chunk
+    {
+        char * data;
+        size_t size;
+    };
+
+    void release(size_t keep)
+    {
+        while (chunks_.size() > keep)
+        {
+            upstream_.deallocate(chunks_.back().data, chunks_.back().size);
+            chunks_.pop_back();
+        }
+    }
+
+    MemoryResource & upstream_;
+    std::vector<Chunk> chunks_;
+    size_t current_ = 0;
+    size_t offset_ = 0;
+};
+
+namespace detail
+{
+
+struct ThreadArena
+{
+    ArenaResource arena;
+    size_t scopes = 0;
+};
+
+inline ThreadArena & thread_arena()
+{
+    static thread_local ThreadArena state;
+    return state;
+}
+
+}  // namespace detail
+
+// the arena of this thread while an ArenaScope is open on it, operator new otherwise
+inline MemoryResource & query_resource()
+{
+    detail::ThreadArena & state = detail::thread_arena();
+    return state.scopes != 0 ? static_cast<MemoryResource &>(state.arena) : new_delete_resource();
+}
+
+/**
+ * Routes query_resource() to the thread's arena for its lifetime and releases
+ * what was allocated from it meanwhile when it ends; scopes nest
+ */
+class ArenaScope
+{
+public:
+    ArenaScope() : state_(detail::thread_arena()), mark_(state_.arena.mark())
+    {
+        ++state_.scopes;
+    }
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope & operator=(const ArenaScope &) = delete;
+
+    ~ArenaScope()
+    {
+        state_.arena.rewind(mark_);
+        --state_.scopes;
+    }
+
+private:
+    detail::ThreadArena & state_;
+    ArenaResource::Mark mark_;
+};
+
+// standard allocator over a MemoryResource, for the containers of the engines
+template <typename T>
+class ResourceAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit ResourceAllocator(MemoryResource & resource) : resource_(&resource)
+    {}
+
+    template <typename U>
+    ResourceAllocator(const ResourceAllocator<U> & other) : resource_(other.resource())
+    {}
+
+    T * allocate(size_t n)
+    {
+        return static_cast<T *>(resource_->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T * pointer, size_t n)
+    {
+        resource_->deallocate(pointer, n * sizeof(T));
+    }
+
+    MemoryResource * resource() const { return resource_; }
+
+private:
+    MemoryResource * resource_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ResourceAllocator<T> & a, const ResourceAllocator<U> & b)
+{
+    return a.resource() == b.resource();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ResourceAllocator<T> & a, const ResourceAllocator<U> & b)
+{
+    return !(a == b);
+}
+
+}  // namespace fuzzy
+
+#endif  // FUZZY_SEARCH_MEMORY_H
@@ -0,0 +1,76 @@
+#ifndef FUZZY_SEARCH_STATS_H
+#define FUZZY_SEARCH_STATS_H
+
+/**
+ * Hot-path counters of the search engines (Bitap, fuzzy_search, libflasm and
+ * the SeqAn Myers, Pex and ABNDM finders).
+ *
+ * The counters are compiled in only when FUZZY_SEARCH_STATS is defined (cmake
+ * -DFUZZY_SEARCH_STATS=ON); otherwise FUZZY_STATS_ADD expands to nothing and
+ * search_stats() always returns zeros. Engines add to a thread-local
+ * SearchStats, so a query can be profiled with
+ *
+ *     fuzzy::reset_search_stats();
+ *     ... run the query ...
+ *     fuzzy::SearchStats stats = fuzzy::search_stats();
+ *
+ * Engines add their counts once per call or per block rather than per
+ * character where they can, so enabled counters stay cheap as well.
+ */
+
+namespace fuzzy
+{
+
+struct SearchStats
+{
+    unsigned long long bytes_scanned = 0;         // text characters read by an engine
+    unsigned long long shifts = 0;                // window shifts of the filtering engines
+    unsigned long long shift_length = 0;          // text characters skipped by those shifts
+    unsigned long long filter_hits = 0;           // candidate windows reported by a filter
+    unsigned long long verifications = 0;         // candidate windows verified
+    unsigned long long verifications_passed = 0;  // verifications that found an occurrence
+    unsigned long long myers_blocks = 0;          // machine-word blocks computed by Myers' algorithm
+    unsigned long long cells = 0;                 // dynamic programming cells computed by libflasm
+};
+
+#ifdef FUZZY_SEARCH_STATS
+
+constexpr bool search_stats_enabled = true;
+
+inline SearchStats & thread_search_stats()
+{
+    static thread_local SearchStats stats;
+    return stats;
+}
+
+#define FUZZY_STATS_ADD(field, n) (::fuzzy::thread_search_stats().field += (n))
+
+inline SearchStats search_stats()
+{
+    return thread_search_stats();
+}
+
+inline void reset_search_stats()
+{
+    thread_search_stats() = SearchStats();
+}
+
+#else
+
+constexpr bool search_stats_enabled = false;
+
+#define FUZZY_STATS_ADD(field, n) ((void) 0)
+
+inline SearchStats search_stats()
+{
+    return SearchStats();
+}
+
+inline void reset_search_stats()
+{}
+
+#endif
+
+}  // namespace fuzzy
+
+#endif  // FUZZY_SEARCH_STATS_H
@@ -48,6 +48,9 @@
 #include <seqan/map.h>
 #include <seqan/parallel.h>
 
+// FUZZY_STATS_ADD, the opt-in hot-path counters of the approximate finders
+#include <fuzzy_search/stats.h>
+
 // ===========================================================================
 // Base headers.
 // ===========================================================================
@@ -77,6 +80,7 @@
 // ===========================================================================
 
 #include <seqan/find/find_ahocorasick.h>
+#include <seqan/find/find_ahocorasick_dense.h>
 #include <seqan/find/find_multiple_shiftand.h>
 #include <seqan/find/find_set_horspool.h>
 
@@ -92,10 +96,14 @@
 
 #include <seqan/find/find_score.h>
 #include <seqan/find/find_myers_ukkonen.h>
+#include <seqan/find/find_myers_batch.h>
 #include <seqan/find/find_abndm.h>
 #include <seqan/find/find_pex.h>
+#include <seqan/find/find_multi_pex.h>
+#include <seqan/find/find_pex_pipelined.h>
 
 #include <seqan/find/find_hamming_simple.h>
+#include <seqan/find/find_hamming_shiftadd.h>
 
 // ===========================================================================
 // Lambda interface.
@@ -290,6 +290,7 @@ inline bool _findAbndmSmallNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
         std::cout << "original start pos: " << startPos << std::endl;
 #endif
 
+        FUZZY_STATS_ADD(verifications, 1);
         while(find(f,me.verifier,- (int) me.limit)){
             TWord newP = position(finder) + position(f);
 #ifdef SEQAN_DEBUG_ABNDM
@@ -297,19 +298,22 @@ inline bool _findAbndmSmallNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
 #endif
             if(newP > startPos){
                 finder += position(f);
+                FUZZY_STATS_ADD(verifications_passed, 1);
                 return true;
             }
         }
 #ifdef SEQAN_DEBUG_ABNDM
         std::cout << "additional verification done .. shifted by last=" << me.last << std::endl << std::endl;
 #endif
+        FUZZY_STATS_ADD(shifts, 1);
+        FUZZY_STATS_ADD(shift_length, me.last);
         finder += me.last;
         me.cP += me.last;
     }
 
     me.cP = position(finder);
-    // walk on
-    while (position(finder) <= me.haystackLength - me.needleLength)
+    // walk on, the shortest occurrences have needleLength - limit values
+    while (position(finder) + me.needleLength <= me.haystackLength + me.limit)
     {
             j = me.needleLength - me.limit - 1;
         me.last = j;
@@ -370,11 +374,13 @@ inline bool _findAbndmSmallNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
             std::cout << "init finder on: " << s << std::endl;
 #endif
                     // try to find the sequence
+                    FUZZY_STATS_ADD(verifications, 1);
                     while(find(f,me.verifier,- (int) me.limit)){
                         TWord nP = position(finder) + position(f);
                         if(nP > startPos){
                             finder += position(f);
                             me.findNext = true;
+                            FUZZY_STATS_ADD(verifications_passed, 1);
                             return true;
                         }
                     }
@@ -385,6 +391,8 @@ inline bool _findAbndmSmallNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
         std::cout << "automaton runs out of active stats so window is shifted by last=" << me.last << std::endl << std::endl;
 #endif
 
+        FUZZY_STATS_ADD(shifts, 1);
+        FUZZY_STATS_ADD(shift_length, me.last);
         finder += me.last;
         me.cP += me.last;
     }
@@ -424,6 +432,7 @@ inline bool _findAbndmLargeNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
         std::cout << "original start pos: " << startPos << std::endl;
 #endif
 
+        FUZZY_STATS_ADD(verifications, 1);
         while(find(f,me.verifier,- (int) me.limit)){
             TWord newP = position(finder) + position(f);
 #ifdef SEQAN_DEBUG_ABNDM
@@ -431,17 +440,20 @@ inline bool _findAbndmLargeNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
 #endif
             if(newP > startPos){
                 finder += position(f);
+                FUZZY_STATS_ADD(verifications_passed, 1);
                 return true;
             }
         }
 #ifdef SEQAN_DEBUG_ABNDM
         std::cout << "additional verification done .. shifted by last=" << me.last << std::endl << std::endl;
 #endif
+        FUZZY_STATS_ADD(shifts, 1);
+        FUZZY_STATS_ADD(shift_length, me.last);
         finder += me.last;
         me.cP += me.last;
     }else me.cP = position(finder);
-    // walk on
-    while (position(finder) <= me.haystackLength - me.needleLength)
+    // walk on, the shortest occurrences have needleLength - limit values
+    while (position(finder) + me.needleLength <= me.haystackLength + me.limit)
     {
             j = me.needleLength - me.limit - 1;
         me.last = j;
@@ -541,6 +553,7 @@ inline bool _findAbndmLargeNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
                     std::cout << "init finder on: " << s << std::endl;
 #endif
                     // try to find the sequence
+                    FUZZY_STATS_ADD(verifications, 1);
                     while(find(f,me.verifier,- (int) me.limit)){
                         TWord nP = position(finder) + position(f);
                         if(nP > startPos){
@@ -549,6 +562,7 @@ inline bool _findAbndmLargeNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
                             std::cout << "found pattern at position " << position(finder) << std::endl;
 #endif
                             me.findNext = true;
+                            FUZZY_STATS_ADD(verifications_passed, 1);
                             return true;
                         }
                     }
@@ -559,6 +573,8 @@ inline bool _findAbndmLargeNeedle(TFinder & finder, Pattern<TNeedle, AbndmAlgo>
         std::cout << "automaton runs out of active stats so window is shifted by last=" << me.last << std::endl << std::endl;
 #endif
 
+        FUZZY_STATS_ADD(shifts, 1);
+        FUZZY_STATS_ADD(shift_length, me.last);
         finder += me.last;
         me.cP += me.last;
     }
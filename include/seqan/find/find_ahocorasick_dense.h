@@ -0,0 +1,383 @@
+// ==========================================================================
+//                 SeqAn - The Library for Sequence Analysis
+// ==========================================================================
+// Copyright (c) 2006-2016, Knut Reinert, FU Berlin
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Knut Reinert or the FU Berlin nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL KNUT REINERT OR THE FU BERLIN BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+// OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+// DAMAGE.
+//
+// ==========================================================================
+// Aho-Corasick with a dense, failure-closed transition table.
+// ==========================================================================
+
+#ifndef SEQAN_HEADER_FIND_AHOCORASICK_DENSE_H
+#define SEQAN_HEADER_FIND_AHOCORASICK_DENSE_H
+
+namespace seqan
+{
+
+//////////////////////////////////////////////////////////////////////////////
+// AhoCorasickDense
+//////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * @class AhoCorasickDensePattern
+ * @extends Pattern
+ * @headerfile <seqan/find.h>
+ * @brief Multiple exact string matching using an Aho-Corasick automaton compiled into a transition table.
+ *
+ * @signature template <typename TNeedle>
+ *            class Pattern<TNeedle, AhoCorasickDense>;
+ *
+ * @tparam TNeedle The needle type, a string of keywords.
+ *
+ * Finds the same occurrences as @link AhoCorasickPattern @endlink. Instead of the trie graph and its supply
+ * links, the automaton is a table with one row per trie node and one column per character class. The failure
+ * links are resolved while the table is built, so every haystack character costs one table load. The
+ * characters that occur in no keyword share one class, which keeps the rows as short as the alphabet of the
+ * keywords, e.g. 27 columns for lower case words over char.
+ *
+ * The table takes 4 * (nodes) * (classes) bytes, which favours dictionaries over small alphabets; the trie of
+ * @link AhoCorasickPattern @endlink is smaller for large ones. Rows are addressed by 31 bit offsets, needles whose
+ * table would have 2^31 entries or more throw a RuntimeError when the table is built. Empty keywords are never found.
+ *
+ * The types of the keywords in the needle container and the haystack have to match. If multiple keywords end at
+ * the same position, the longer ones are reported first and equal ones in the order of the needle container.
+ */
+
+struct AhoCorasickDense_;
+typedef Tag<AhoCorasickDense_> AhoCorasickDense;
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename TNeedle>
+class Pattern<TNeedle, AhoCorasickDense> {
+//____________________________________________________________________________
+private:
+    Pattern(Pattern const& other);
+    Pattern const& operator=(Pattern const & other);
+
+//____________________________________________________________________________
+public:
+    typedef typename Size<TNeedle>::Type TSize;
+    typedef uint32_t TState;
+
+    // A table entry is the offset of the next state's row, its top bit is set
+    // if a keyword ends in that state.
+    static const TState OUTPUT = (TState)1 << 31;
+    static const TState NONE = ~(TState)0;
+
+    Holder<TNeedle> data_host;
+    String<TState> data_classes;        // Column of each character, 0 for those not in any keyword
+    String<TState> data_table;          // Rows of classCount entries, the root's first
+    String<TState> data_keywords;       // Keywords ending in each state, delimited by data_keywordBegin
+    String<TState> data_keywordBegin;
+    String<TState> data_outputLink;     // Longest proper suffix state with keywords of its own, or NONE
+    TState data_classCount;
+
+    // To restore the automaton after a hit
+    String<TSize> data_endPositions;    // All remaining keyword indices, the next one last
+    TSize data_keywordIndex;            // Current keyword that produced a hit
+    TSize data_needleLength;            // Last length of needle to reposition finder
+    TState data_lastState;              // Row of the last state in the automaton
+
+//____________________________________________________________________________
+
+    Pattern() : data_classCount(1), data_keywordIndex(0), data_needleLength(0), data_lastState(0)
+    {}
+
+    template <typename TNeedle2>
+    Pattern(TNeedle2 && ndl,
+            SEQAN_CTOR_DISABLE_IF(IsSameType<typename std::remove_reference<TNeedle2>::type const &, Pattern const &>))
+        : data_classCount(1), data_keywordIndex(0), data_needleLength(0), data_lastState(0)
+    {
+        setHost(*this, std::forward<TNeedle2>(ndl));
+        ignoreUnusedVariableWarning(dummy);
+    }
+
+//____________________________________________________________________________
+};
+
+template <typename TNeedle>
+const typename Pattern<TNeedle, AhoCorasickDense>::TState Pattern<TNeedle, AhoCorasickDense>::OUTPUT;
+
+template <typename TNeedle>
+const typename Pattern<TNeedle, AhoCorasickDense>::TState Pattern<TNeedle, AhoCorasickDense>::NONE;
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Functions
+//////////////////////////////////////////////////////////////////////////////
+
+// Nodes of the trie of the keywords, the root included. Sorted lexicographically, every keyword adds the
+// characters behind its common prefix with its predecessor.
+template <typename TNeedle>
+inline uint64_t
+_acDenseTrieSize(TNeedle const & ndl)
+{
+    typedef typename Value<TNeedle const>::Type TKeyword;
+    typedef typename Value<TKeyword>::Type TAlphabet;
+    typedef typename Size<TNeedle>::Type TSize;
+
+    auto lessChar = [](TAlphabet const & a, TAlphabet const & b) { return ordValue(a) < ordValue(b); };
+    String<TSize> order;
+    resize(order, length(ndl), Exact());
+    for (TSize i = 0; i < length(order); ++i)
+        order[i] = i;
+    std::sort(begin(order, Standard()), end(order, Standard()), [&](TSize a, TSize b) {
+        TKeyword const & x = ndl[a];
+        TKeyword const & y = ndl[b];
+        return std::lexicographical_compare(begin(x, Standard()), end(x, Standard()),
+                                            begin(y, Standard()), end(y, Standard()), lessChar);
+    });
+
+    uint64_t nodes = 1;
+    for (TSize i = 0; i < length(order); ++i) {
+        TKeyword const & x = ndl[order[i]];
+        TSize common = 0;
+        if (i != 0) {
+            TKeyword const & y = ndl[order[i - 1]];
+            while (common < length(x) && common < length(y) && ordValue(x[common]) == ordValue(y[common]))
+                ++common;
+        }
+        nodes += length(x) - common;
+    }
+    return nodes;
+}
+
+template <typename TNeedle>
+inline void
+_createAcTable(Pattern<TNeedle, AhoCorasickDense> & me)
+{
+    typedef Pattern<TNeedle, AhoCorasickDense> TPattern;
+    typedef typename TPattern::TState TState;
+    typedef typename Value<TNeedle>::Type TKeyword;
+    typedef typename Value<TKeyword>::Type TAlphabet;
+    typedef typename Iterator<TNeedle const, Rooted>::Type TNeedleIterator;
+
+    TNeedle const & ndl = host(me);
+
+    // Number the characters of the keywords in order of appearance
+    clear(me.data_classes);
+    resize(me.data_classes, (TState)ValueSize<TAlphabet>::VALUE, 0, Exact());
+    me.data_classCount = 1;
+    uint64_t characters = 0;
+    for (TNeedleIterator it = begin(ndl); !atEnd(it); goNext(it)) {
+        characters += length(*it);
+        for (TState i = 0; i < length(*it); ++i) {
+            TState & cls = me.data_classes[ordValue(getValue(*it, i))];
+            if (cls == 0)
+                cls = me.data_classCount++;
+        }
+    }
+    TState const classes = me.data_classCount;
+
+    // The row offsets and the trie's edges have to stay below the output flag,
+    // count the nodes exactly only if the keywords might exceed it
+    if ((characters + 1) * classes >= TPattern::OUTPUT && _acDenseTrieSize(ndl) * classes >= TPattern::OUTPUT)
+        SEQAN_THROW(RuntimeError("AhoCorasickDense: the transition table needs 2^31 entries or more"));
+
+    // Trie, a transition to 0 is no transition as no edge enters the root
+    String<TState> trie;
+    resize(trie, classes, 0);
+    String<TState> keywordState;
+    resize(keywordState, length(ndl), TPattern::NONE, Exact());
+    for (TNeedleIterator it = begin(ndl); !atEnd(it); goNext(it)) {
+        if (empty(*it))
+            continue;
+        TState state = 0;
+        for (TState i = 0; i < length(*it); ++i) {
+            TState const edge = state * classes + me.data_classes[ordValue(getValue(*it, i))];
+            if (trie[edge] == 0) {
+                trie[edge] = length(trie) / classes;
+                resize(trie, length(trie) + classes, 0);
+            }
+            state = trie[edge];
+        }
+        keywordState[position(it)] = state;
+    }
+    TState const states = length(trie) / classes;
+    SEQAN_ASSERT_LT((uint64_t)states * classes, (uint64_t)TPattern::OUTPUT);
+
+    // Keywords of each state, in the order of the needle
+    String<TState> keywordBegin;
+    resize(keywordBegin, states + 1, 0, Exact());
+    for (TState i = 0; i < length(keywordState); ++i)
+        if (keywordState[i] != TPattern::NONE)
+            ++keywordBegin[keywordState[i] + 1];
+    for (TState s = 0; s < states; ++s)
+        keywordBegin[s + 1] += keywordBegin[s];
+    String<TState> keywords;
+    resize(keywords, keywordBegin[states], Exact());
+    String<TState> fill = prefix(keywordBegin, states);
+    for (TState i = 0; i < length(keywordState); ++i)
+        if (keywordState[i] != TPattern::NONE)
+            keywords[fill[keywordState[i]]++] = i;
+
+    // Breadth-first, every state takes the transitions its trie node lacks
+    // from its failure state, which is shallower and thus complete already
+    String<TState> fail;
+    resize(fail, states, 0, Exact());
+    String<TState> outputLink;
+    resize(outputLink, states, TPattern::NONE, Exact());
+    String<TState> queue;
+    reserve(queue, states, Exact());
+    appendValue(queue, 0);
+    for (TState c = 0; c < classes; ++c)
+        if (trie[c] != 0)
+            appendValue(queue, trie[c]);
+    for (TState head = 1; head < length(queue); ++head) {
+        TState const s = queue[head];
+        TState const f = fail[s];
+        for (TState c = 0; c < classes; ++c) {
+            TState & next = trie[s * classes + c];
+            if (next != 0) {
+                fail[next] = trie[f * classes + c];
+                appendValue(queue, next);
+            } else {
+                next = trie[f * classes + c];
+            }
+        }
+        outputLink[s] = keywordBegin[f] != keywordBegin[f + 1] ? f : outputLink[f];
+    }
+
+    // Number the states breadth-first, so the shallow states most characters
+    // lead to share few cache lines, and store row offsets with output flags,
+    // so a step is one load
+    String<TState> rank;
+    resize(rank, states, Exact());
+    for (TState i = 0; i < states; ++i)
+        rank[queue[i]] = i;
+    clear(me.data_table);
+    resize(me.data_table, length(trie), Exact());
+    clear(me.data_outputLink);
+    resize(me.data_outputLink, states, Exact());
+    clear(me.data_keywordBegin);
+    resize(me.data_keywordBegin, states + 1, Exact());
+    clear(me.data_keywords);
+    reserve(me.data_keywords, length(keywords), Exact());
+    me.data_keywordBegin[0] = 0;
+    for (TState i = 0; i < states; ++i) {
+        TState const s = queue[i];
+        for (TState c = 0; c < classes; ++c) {
+            TState const t = trie[s * classes + c];
+            bool const output = keywordBegin[t] != keywordBegin[t + 1] || outputLink[t] != TPattern::NONE;
+            me.data_table[i * classes + c] = rank[t] * classes | (output ? TPattern::OUTPUT : 0);
+        }
+        me.data_outputLink[i] = outputLink[s] != TPattern::NONE ? rank[outputLink[s]] : TPattern::NONE;
+        append(me.data_keywords, infix(keywords, keywordBegin[s], keywordBegin[s + 1]));
+        me.data_keywordBegin[i + 1] = length(me.data_keywords);
+    }
+}
+
+
+template <typename TNeedle>
+void _reinitPattern(Pattern<TNeedle, AhoCorasickDense> & me) {
+    SEQAN_ASSERT_NOT(empty(needle(me)));
+    clear(me.data_endPositions);
+    _createAcTable(me);
+    me.data_needleLength = 0;
+}
+
+//____________________________________________________________________________
+
+
+template <typename TNeedle>
+inline void _patternInit (Pattern<TNeedle, AhoCorasickDense> & me)
+{
+    clear(me.data_endPositions);
+    me.data_keywordIndex = 0;
+    me.data_lastState = 0;
+}
+
+
+//____________________________________________________________________________
+
+
+template <typename TNeedle>
+inline typename Size<TNeedle>::Type
+position(Pattern<TNeedle, AhoCorasickDense> & me)
+{
+    return me.data_keywordIndex;
+}
+
+
+// Reports the next keyword of data_endPositions and positions the finder on it
+template <typename TFinder, typename TNeedle>
+inline void _reportAcDenseHit(TFinder & finder, Pattern<TNeedle, AhoCorasickDense> & me) {
+    me.data_keywordIndex = back(me.data_endPositions);
+    _setLength(me.data_endPositions, length(me.data_endPositions) - 1);
+    me.data_needleLength = length(value(host(me), me.data_keywordIndex))-1;
+    finder -= me.data_needleLength;
+    _setFinderLength(finder, me.data_needleLength+1);
+    _setFinderEnd(finder, position(finder)+length(finder));
+}
+
+
+template <typename TFinder, typename TNeedle>
+inline bool find(TFinder & finder, Pattern<TNeedle, AhoCorasickDense> & me) {
+    typedef Pattern<TNeedle, AhoCorasickDense> TPattern;
+    typedef typename TPattern::TState TState;
+
+    if (empty(finder)) {
+        _patternInit(me);
+        _finderSetNonEmpty(finder);
+    } else {
+        finder += me.data_needleLength;
+        ++finder; // Set forward the finder
+    }
+
+    // Process left-over hits
+    if (!empty(me.data_endPositions)) {
+        --finder; // Set back the finder
+        _reportAcDenseHit(finder, me);
+        return true;
+    }
+
+    TState const * table = begin(me.data_table, Standard());
+    TState const * classes = begin(me.data_classes, Standard());
+    TState current = me.data_lastState;
+    while (!atEnd(finder)) {
+        current = table[(current & ~TPattern::OUTPUT) + classes[ordValue(*finder)]];
+        if (current & TPattern::OUTPUT) {
+            // queue the keywords of the state and its output links, the first one last
+            for (TState s = (current & ~TPattern::OUTPUT) / me.data_classCount; s != TPattern::NONE;
+                 s = me.data_outputLink[s])
+                for (TState i = me.data_keywordBegin[s]; i != me.data_keywordBegin[s + 1]; ++i)
+                    appendValue(me.data_endPositions, me.data_keywords[i]);
+            std::reverse(begin(me.data_endPositions, Standard()), end(me.data_endPositions, Standard()));
+            me.data_lastState = current & ~TPattern::OUTPUT;
+            _reportAcDenseHit(finder, me);
+            return true;
+        }
+        ++finder;
+    }
+    me.data_lastState = current & ~TPattern::OUTPUT;
+    return false;
+}
+
+}// namespace seqan
+
+#endif //#ifndef SEQAN_HEADER_FIND_AHOCORASICK_DENSE_H
@@ -0,0 +1,395 @@
+// ==========================================================================
+//                 SeqAn - The Library for Sequence Analysis
+// ==========================================================================
+// Copyright (c) 2006-2016, Knut Reinert, FU Berlin
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Knut Reinert or the FU Berlin nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL KNUT REINERT OR THE FU BERLIN BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+// OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+// DAMAGE.
+//
+// ==========================================================================
+// Bit-parallel approximate string matching with Hamming distance.
+// ==========================================================================
+
+#ifndef SEQAN_FIND_FIND_HAMMING_SHIFTADD_H_
+#define SEQAN_FIND_FIND_HAMMING_SHIFTADD_H_
+
+namespace seqan {
+
+/*!
+ * @class HammingShiftAddPattern
+ * @extends Pattern
+ * @headerfile <seqan/find.h>
+ * @brief A bit-parallel online searching algorithm for approximate string matching with hamming distance.
+ *
+ * @signature template <typename TNeedle>
+ *            class Pattern<TNeedle, HammingShiftAdd>;
+ *
+ * @tparam TNeedle The needle type. Types: String
+ *
+ * Shift-Add (Baeza-Yates and Gonnet, 1992): every needle position has a mismatch counter of
+ * b = ceil(log2(k + 1)) + 1 bits, and the counters of w / b positions share a 64 bit word. One shift and one
+ * addition of the mask of the haystack character per word advance all windows at once, so a search takes
+ * O(n * ceil(m * b / 64)) time, independent of the haystack. A counter exceeding 2^(b - 1) - 1 sets its top bit,
+ * which is moved into an overflow word that shifts along with it.
+ *
+ * Reports the same occurrences in the same order as HammingSimplePattern. The N handling enabled with
+ * _patternMatchNOfPattern() and _patternMatchNOfFinder() is folded into the character masks. Unlike
+ * HammingSimplePattern, which implements it for Dna5 only, it applies to the unknownValue() of any alphabet
+ * ('N' for char): an N of the needle (resp. haystack) matches every character.
+ */
+
+struct HammingShiftAdd_;
+typedef Tag<HammingShiftAdd_> HammingShiftAdd;
+
+
+template <typename TNeedle>
+class Pattern<TNeedle, HammingShiftAdd> {
+public:
+    typedef uint64_t TWord;
+
+    // The holder for the needle.
+    Holder<TNeedle> data_host;
+
+    // The maximal distance.  Must be >= 0, i.e. -score.
+    int maxDistance;
+
+    // The current distance, >= 0, i.e. -current score.
+    int distance;
+
+    // Flags -- ..1xx activate, ..01 match pattern, ..10 match finder, as for HammingSimple.
+    unsigned matchNFlags;
+
+    // Layout of the counters, set up for a distance by _hammingShiftAddInit().
+    unsigned counterBits;
+    unsigned countersPerWord;
+    unsigned blockCount;
+    TWord counterMask;   // the bits of the words taken by counters
+    TWord highBits;      // the top bit of every counter
+
+    String<TWord> masks;     // blockCount words per character, 1 at the low bit of the counters it mismatches
+    String<TWord> counters;
+    String<TWord> overflow;
+
+    size_t fed;   // haystack characters added since the counters were cleared
+    size_t next;  // haystack position of the next character
+    bool ready;   // masks and layout are valid for the needle and flags
+
+    Pattern() : maxDistance(-1), distance(0), matchNFlags(0), counterBits(0), countersPerWord(0), blockCount(0),
+                counterMask(0), highBits(0), fed(0), next(0), ready(false) {}
+
+    template <typename TNeedle2>
+    Pattern(TNeedle2 && ndl,
+            int k = -1,
+            SEQAN_CTOR_DISABLE_IF(IsSameType<typename std::remove_reference<TNeedle2>::type const &, Pattern const &>))
+                :   maxDistance(-k),
+                    distance(0),
+                    matchNFlags(0),
+                    counterBits(0),
+                    countersPerWord(0),
+                    blockCount(0),
+                    counterMask(0),
+                    highBits(0),
+                    fed(0),
+                    next(0),
+                    ready(false)
+    {
+        setHost(*this, std::forward<TNeedle2>(ndl));
+        ignoreUnusedVariableWarning(dummy);
+    }
+
+};
+
+
+template <typename TNeedle>
+inline void _reinitPattern(Pattern<TNeedle, HammingShiftAdd> & me)
+{
+    me.ready = false;
+}
+
+
+template <typename TNeedle>
+inline void _patternMatchNOfPattern(Pattern<TNeedle, HammingShiftAdd> & pattern, bool matchN)
+{
+    if (matchN)
+        pattern.matchNFlags |= 1;  // |= 01b
+    else
+        pattern.matchNFlags &= 2;  // &= 10b
+    pattern.matchNFlags |= 4;
+    pattern.ready = false;
+}
+
+
+template <typename TNeedle>
+inline void _patternMatchNOfFinder(Pattern<TNeedle, HammingShiftAdd> & pattern, bool matchN)
+{
+    if (matchN)
+        pattern.matchNFlags |= 2;  // |= 10b
+    else
+        pattern.matchNFlags &= 1;  // &= 01b
+    pattern.matchNFlags |= 4;
+    pattern.ready = false;
+}
+
+
+template <typename TNeedle>
+inline int score(const Pattern<TNeedle, HammingShiftAdd> &me) {
+    return -me.distance;
+}
+
+
+template <typename TNeedle>
+inline int getScore(const Pattern<TNeedle, HammingShiftAdd> &me) {
+    return -me.distance;
+}
+
+
+template <typename TNeedle>
+inline void setScoreLimit(Pattern<TNeedle, HammingShiftAdd> & me, int _limit) {
+    SEQAN_ASSERT_LEQ(_limit, 0);
+    me.maxDistance = -_limit;
+}
+
+
+// Sets up counters that hold at least maxDistance mismatches and the character masks.
+template <typename TNeedle>
+inline void _hammingShiftAddInit(Pattern<TNeedle, HammingShiftAdd> & me, unsigned maxDistance)
+{
+    typedef typename Pattern<TNeedle, HammingShiftAdd>::TWord TWord;
+    typedef typename Value<TNeedle>::Type TValue;
+
+    TNeedle const & ndl = needle(me);
+    size_t const m = length(ndl);
+
+    unsigned bits = 1;
+    while ((((TWord)1 << (bits - 1)) - 1) < maxDistance)
+        ++bits;
+    me.counterBits = bits;
+    me.countersPerWord = BitsPerValue<TWord>::VALUE / bits;
+    me.blockCount = m == 0 ? 1 : (unsigned)((m - 1) / me.countersPerWord + 1);
+    me.counterMask = me.countersPerWord * bits == BitsPerValue<TWord>::VALUE
+            ? ~(TWord)0 : ((TWord)1 << (me.countersPerWord * bits)) - 1;
+    TWord low = 0;
+    for (unsigned i = 0; i < me.countersPerWord; ++i)
+        low |= (TWord)1 << (i * bits);
+    me.highBits = low << (bits - 1);
+
+    // The N of the needle matches every character, every character matches the N of the haystack.
+    bool const nOfPattern = (me.matchNFlags & 4u) && (me.matchNFlags & 1u);
+    bool const nOfFinder = (me.matchNFlags & 4u) && (me.matchNFlags & 2u);
+    unsigned const unknown = ordValue(unknownValue<TValue>());
+
+    // Every character starts out mismatching every needle position, then each
+    // needle character clears its position in its own row (in all rows for a
+    // matching N), so the set up is linear in the needle and alphabet size.
+    clear(me.masks);
+    resize(me.masks, (size_t)ValueSize<TValue>::VALUE * me.blockCount, 0, Exact());
+    for (size_t i = 0; i < m; ++i)
+        me.masks[i / me.countersPerWord] |= (TWord)1 << ((i % me.countersPerWord) * bits);
+    for (unsigned c = 1; c < (unsigned)ValueSize<TValue>::VALUE; ++c)
+        for (unsigned b = 0; b < me.blockCount; ++b)
+            me.masks[c * me.blockCount + b] = me.masks[b];
+    for (size_t i = 0; i < m; ++i)
+    {
+        unsigned ndlChar = ordValue(getValue(ndl, i));
+        TWord const bit = (TWord)1 << ((i % me.countersPerWord) * bits);
+        size_t const block = i / me.countersPerWord;
+        if (nOfPattern && ndlChar == unknown)
+            for (unsigned c = 0; c < (unsigned)ValueSize<TValue>::VALUE; ++c)
+                me.masks[c * me.blockCount + block] &= ~bit;
+        else
+            me.masks[ndlChar * me.blockCount + block] &= ~bit;
+    }
+    if (nOfFinder)
+        for (unsigned b = 0; b < me.blockCount; ++b)
+            me.masks[unknown * me.blockCount + b] = 0;
+
+    clear(me.counters);
+    resize(me.counters, me.blockCount, 0, Exact());
+    clear(me.overflow);
+    resize(me.overflow, me.blockCount, 0, Exact());
+    me.fed = 0;
+    me.ready = true;
+}
+
+
+// Adds the haystack characters from pos on to the counters until a window ends within maxDistance, and returns
+// its last position, or n. BLOCKS words of counters are held in local variables, which the compiler keeps in
+// registers, BLOCKS = 0 runs on the blockCount words of the pattern.
+template <unsigned BLOCKS, typename TNeedle, typename THaystackIterator>
+inline size_t _hammingShiftAddScan(Pattern<TNeedle, HammingShiftAdd> & me, THaystackIterator it, size_t pos,
+                                   size_t n, size_t m, unsigned maxDistance, unsigned & distance)
+{
+    typedef typename Value<TNeedle>::Type TValue;
+    typedef typename Pattern<TNeedle, HammingShiftAdd>::TWord TWord;
+
+    unsigned const bits = me.counterBits;
+    unsigned const top = (me.countersPerWord - 1) * bits;
+    unsigned const blockCount = BLOCKS != 0 ? BLOCKS : me.blockCount;
+    TWord const counterMask = me.counterMask;
+    TWord const highBits = me.highBits;
+    TWord const valueMask = ((TWord)1 << (bits - 1)) - 1;
+    unsigned const lastBlock = (unsigned)((m - 1) / me.countersPerWord);
+    unsigned const lastShift = (unsigned)((m - 1) % me.countersPerWord) * bits;
+    TWord const * masks = begin(me.masks, Standard());
+
+    TWord local[BLOCKS != 0 ? 2 * BLOCKS : 1];
+    TWord * counters = BLOCKS != 0 ? local : begin(me.counters, Standard());
+    TWord * overflow = BLOCKS != 0 ? local + BLOCKS : begin(me.overflow, Standard());
+    for (unsigned block = 0; BLOCKS != 0 && block < BLOCKS; ++block) {
+        counters[block] = me.counters[block];
+        overflow[block] = me.overflow[block];
+    }
+
+    // a member would be stored on every character, as the counters may alias it
+    size_t fed = me.fed;
+    for (; pos < n; ++pos, ++it) {
+        TWord const * mask = masks + (size_t)ordValue(convert<TValue>(*it)) * blockCount;
+
+        // Move every counter one position up, the top one of a word to the bottom of the next.
+        TWord carry = 0, carryOverflow = 0;
+        for (unsigned block = 0; block < blockCount; ++block) {
+            TWord c = counters[block], o = overflow[block];
+            TWord sum = (((c << bits) | carry) & counterMask) + mask[block];
+            TWord high = sum & highBits;
+            counters[block] = sum ^ high;
+            overflow[block] = (((o << bits) | carryOverflow) & counterMask) | high;
+            carry = c >> top;
+            carryOverflow = o >> top;
+        }
+
+        if (++fed < m)
+            continue;
+        if ((overflow[lastBlock] >> (lastShift + bits - 1)) & 1)
+            continue;
+        distance = (unsigned)((counters[lastBlock] >> lastShift) & valueMask);
+        if (distance <= maxDistance)
+            break;
+    }
+
+    me.fed = fed;
+    for (unsigned block = 0; BLOCKS != 0 && block < BLOCKS; ++block) {
+        me.counters[block] = counters[block];
+        me.overflow[block] = overflow[block];
+    }
+    return pos;
+}
+
+
+template <typename TFinder, typename TNeedle>
+inline bool find(TFinder &finder,
+                 Pattern<TNeedle, HammingShiftAdd> &me,
+                 int minScore) {
+
+    typedef typename Haystack<TFinder>::Type THaystack;
+    typedef typename Iterator<THaystack const, Standard>::Type THaystackIterator;
+    typedef typename Pattern<TNeedle, HammingShiftAdd>::TWord TWord;
+
+    // Shortcuts to haystack and needle.
+    THaystack const & hstk = haystack(finder);
+    size_t const n = length(hstk);
+    size_t const m = length(needle(me));
+
+    // If the needle is longer than the haystack then we cannot find anything.
+    if (n < m)
+        return false;
+
+    // Initialize or advance finder, depending whether it has been
+    // initialized before.
+    if (empty(finder)) {
+        _setFinderLength(finder, m);
+        _finderSetNonEmpty(finder);
+    } else {
+        finder += 1;
+    }
+
+    // Check whether we are beyond the last possible match position.
+    size_t const first = position(finder);
+    if (first > n - m)
+        return false;
+
+    if (m == 0) {
+        me.distance = 0;
+        _setFinderEnd(finder, first);
+        setPosition(finder, beginPosition(finder));
+        return true;
+    }
+
+    unsigned const maxDistance = (unsigned)-minScore;
+    if (!me.ready || maxDistance > (((TWord)1 << (me.counterBits - 1)) - 1))
+        _hammingShiftAddInit(me, maxDistance);
+
+    // Continue with the counters of the last call if the finder was only advanced past its match, otherwise
+    // clear them and add the characters of the first window again.
+    size_t pos = first;
+    if (me.fed + 1 >= m && me.next == first + m - 1) {
+        pos = me.next;
+    } else {
+        arrayFill(begin(me.counters, Standard()), end(me.counters, Standard()), 0);
+        arrayFill(begin(me.overflow, Standard()), end(me.overflow, Standard()), 0);
+        me.fed = 0;
+    }
+
+#ifdef FUZZY_SEARCH_STATS
+    size_t const start = pos;
+#endif
+    THaystackIterator it = begin(hstk, Standard()) + pos;
+
+    // Counters of up to eight words are kept in registers.
+    unsigned distance = 0;
+    switch (me.blockCount) {
+        case 1: pos = _hammingShiftAddScan<1>(me, it, pos, n, m, maxDistance, distance); break;
+        case 2: pos = _hammingShiftAddScan<2>(me, it, pos, n, m, maxDistance, distance); break;
+        case 3: pos = _hammingShiftAddScan<3>(me, it, pos, n, m, maxDistance, distance); break;
+        case 4: pos = _hammingShiftAddScan<4>(me, it, pos, n, m, maxDistance, distance); break;
+        case 5: pos = _hammingShiftAddScan<5>(me, it, pos, n, m, maxDistance, distance); break;
+        case 6: pos = _hammingShiftAddScan<6>(me, it, pos, n, m, maxDistance, distance); break;
+        case 7: pos = _hammingShiftAddScan<7>(me, it, pos, n, m, maxDistance, distance); break;
+        case 8: pos = _hammingShiftAddScan<8>(me, it, pos, n, m, maxDistance, distance); break;
+        default: pos = _hammingShiftAddScan<0>(me, it, pos, n, m, maxDistance, distance); break;
+    }
+
+    if (pos == n) {
+        FUZZY_STATS_ADD(bytes_scanned, n - start);
+        me.next = n;
+        return false;
+    }
+    FUZZY_STATS_ADD(bytes_scanned, pos + 1 - start);
+    me.distance = distance;
+    me.next = pos + 1;
+    _setFinderEnd(finder, pos + 1);
+    setPosition(finder, beginPosition(finder));
+    return true;
+}
+
+template <typename TFinder, typename TNeedle>
+inline bool find(TFinder &finder,
+                 Pattern<TNeedle, HammingShiftAdd> &me)
+{
+    return find(finder, me, -me.maxDistance);
+}
+
+}  // namespace seqan
+
+#endif  // SEQAN_FIND_FIND_HAMMING_SHIFTADD_H_
@@ -35,6 +35,15 @@
 #ifndef SEQAN_HEADER_FIND_HORSPOOL_H
 #define SEQAN_HEADER_FIND_HORSPOOL_H
 
+#include <cstring>
+
+// The AVX2 scan for byte alphabets is compiled for the instruction set with a
+// function attribute and picked at runtime, so the header needs no -mavx2.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SEQAN_HORSPOOL_AVX2 1
+#include <immintrin.h>
+#endif
+
 namespace seqan
 {
 
@@ -49,6 +58,12 @@ namespace seqan
  *
  * @brief Exact string matching using Horspool's algorithm (1980).
  *
+ * When haystack and needle are contiguous strings of the same byte type
+ * (char, signed char, unsigned char) and the CPU supports AVX2, find()
+ * compares four characters of the needle (the first, the last and two in
+ * between) against 32 text positions at once and verifies the candidates
+ * with memcmp instead of shifting.
+ *
  * @signature template <typename TNeedle>
  *            class Pattern<TNeedle, Horspool>;
  *
@@ -110,7 +125,7 @@ _reinitPattern(Pattern<TNeedle, Horspool> & me)
     while (jump_width > 1)
     {
         --jump_width;
-        unsigned int pos_ = *it; //conversion value type to unsigned int
+        unsigned int pos_ = ordValue(*it); //conversion value type to unsigned int
         me.data_map[pos_] = jump_width;
         ++it;
     }
@@ -123,6 +138,112 @@ template <typename TNeedle>
 inline void _patternInit (Pattern<TNeedle, Horspool> &) {}
 
 
+//____________________________________________________________________________
+//spec for byte haystacks and needles
+
+// Whether the standard iterators of haystack and needle are pointers to the
+// same byte type, which the AVX2 scan reads directly.
+template <typename THaystackIterator, typename TNeedleIterator>
+struct HorspoolBytes_ : False {};
+
+template <typename THaystackValue, typename TNeedleValue>
+struct HorspoolBytes_<THaystackValue *, TNeedleValue *> :
+    Eval<IsSameType<typename std::remove_const<THaystackValue>::type,
+                    typename std::remove_const<TNeedleValue>::type>::VALUE &&
+         (IsSameType<typename std::remove_const<TNeedleValue>::type, char>::VALUE ||
+          IsSameType<typename std::remove_const<TNeedleValue>::type, signed char>::VALUE ||
+          IsSameType<typename std::remove_const<TNeedleValue>::type, unsigned char>::VALUE)> {};
+
+// Whether the CPU runs the AVX2 scan, checked once.
+inline bool _horspoolHasAvx2()
+{
+#ifdef SEQAN_HORSPOOL_AVX2
+    static bool const supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+    return supported;
+#else
+    return false;
+#endif
+}
+
+template <typename TFinder, typename TNeedle2>
+inline bool
+_findHorspoolAvx2(TFinder &, Pattern<TNeedle2, Horspool> &, bool, False)
+{
+    return false;
+}
+
+#ifdef SEQAN_HORSPOOL_AVX2
+// Every start position whose first, last and two inner characters match the
+// needle is a candidate, 32 positions are tested per step and only the
+// candidates are compared with memcmp. Four probes instead of first and last
+// alone keep frequent characters (spaces, small alphabets) from making most
+// positions candidates. The last start positions that do not fill a vector
+// are tested one by one.
+template <typename TFinder, typename TNeedle2>
+__attribute__((target("avx2")))
+bool
+_findHorspoolAvx2(TFinder & finder,
+                  Pattern<TNeedle2, Horspool> & me,
+                  bool find_first,
+                  True)
+{
+    typedef typename Haystack<TFinder>::Type THaystack;
+    typedef typename Parameter_<THaystack>::Type TParamHaystack;
+    typedef Pattern<TNeedle2, Horspool> TPattern;
+    typedef typename Needle<TPattern>::Type TNeedle;
+
+    TParamHaystack hayst = haystack(finder);
+    TNeedle & ndl = needle(me);
+
+    char const * text = reinterpret_cast<char const *>(begin(hayst, Standard()));
+    char const * pat = reinterpret_cast<char const *>(begin(ndl, Standard()));
+    size_t const text_size = length(hayst);
+    size_t const ndl_size = length(ndl);
+    if (text_size < ndl_size)
+        return false;
+
+    size_t pos = position(finder) + (find_first ? 0 : 1);
+    size_t const pos_end = text_size - ndl_size + 1; //one past the last start position
+    size_t const middle = ndl_size > 2 ? ndl_size - 2 : 0;
+
+    size_t const p1 = ndl_size / 3, p2 = (2 * ndl_size) / 3; //the inner probes
+    __m256i const first = _mm256_set1_epi8(pat[0]);
+    __m256i const last = _mm256_set1_epi8(pat[ndl_size - 1]);
+    __m256i const c1 = _mm256_set1_epi8(pat[p1]);
+    __m256i const c2 = _mm256_set1_epi8(pat[p2]);
+    for (; pos + 32 <= pos_end; pos += 32)
+    {
+        __m256i const eq_first = _mm256_cmpeq_epi8(first, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(text + pos)));
+        __m256i const eq_last = _mm256_cmpeq_epi8(last, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(text + pos + ndl_size - 1)));
+        __m256i const eq1 = _mm256_cmpeq_epi8(c1, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(text + pos + p1)));
+        __m256i const eq2 = _mm256_cmpeq_epi8(c2, _mm256_loadu_si256(reinterpret_cast<__m256i const *>(text + pos + p2)));
+        unsigned int candidates = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(eq_first, eq_last), _mm256_and_si256(eq1, eq2)));
+        while (candidates != 0)
+        {
+            size_t const begin_pos = pos + __builtin_ctz(candidates);
+            if (std::memcmp(text + begin_pos + 1, pat + 1, middle) == 0)
+            {
+                _setFinderEnd(finder, begin_pos + ndl_size);
+                setPosition(finder, begin_pos);
+                return true;
+            }
+            candidates &= candidates - 1;
+        }
+    }
+    for (; pos < pos_end; ++pos)
+    {
+        if (text[pos] == pat[0] && text[pos + ndl_size - 1] == pat[ndl_size - 1] &&
+            std::memcmp(text + pos + 1, pat + 1, middle) == 0)
+        {
+            _setFinderEnd(finder, pos + ndl_size);
+            setPosition(finder, pos);
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
 //____________________________________________________________________________
 
 template <typename TFinder, typename TNeedle2>
@@ -155,6 +276,10 @@ _findHorspool(TFinder & finder,
     TNeedleIterator nit_begin = begin(ndl, Standard());
     TNeedleIterator nit_end = end(ndl, Standard()) - 1; //here the verification begins
 
+    typedef typename HorspoolBytes_<THaystackIterator, TNeedleIterator>::Type TBytes;
+    if (TBytes::VALUE && _horspoolHasAvx2())
+        return _findHorspoolAvx2(finder, me, find_first, TBytes());
+
     unsigned int char_i;
 
     if (find_first)
@@ -164,7 +289,7 @@ _findHorspool(TFinder & finder,
 
 MOVE_FURTHER:
     //move to next position
-    char_i = convert<TNeedleAlphabet>(*it); //conversion to unsigned integer -> into needle space.
+    char_i = ordValue(convert<TNeedleAlphabet>(*it)); //conversion to unsigned integer -> into needle space.
     it_next = it + me.data_map[char_i];
     if (it_next >= haystack_end)
     {//found nothing
@@ -327,7 +452,7 @@ _findHorspool(Finder<String<TValue, FileReader<TFormat, TFile, FileReaderTSpec>
 
 MOVE_FURTHER:
     //move to next position
-    char_i = convert<TNeedleAlphabet>(*it); //conversion to unsigned integer
+    char_i = ordValue(convert<TNeedleAlphabet>(*it)); //conversion to unsigned integer
     it += me.data_map[char_i];
     if (atEnd(it))
     {//found nothing
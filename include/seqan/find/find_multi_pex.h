@@ -0,0 +1,307 @@
+// ==========================================================================
+//                 SeqAn - The Library for Sequence Analysis
+// ==========================================================================
+// Copyright (c) 2006-2016, Knut Reinert, FU Berlin
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Knut Reinert or the FU Berlin nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL KNUT REINERT OR THE FU BERLIN BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+// OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+// DAMAGE.
+//
+// ==========================================================================
+// Approximate search of many needles in one pass, after Pex.
+// ==========================================================================
+
+#ifndef SEQAN_HEADER_FIND_MULTI_PEX_H
+#define SEQAN_HEADER_FIND_MULTI_PEX_H
+
+namespace seqan
+{
+
+template <typename TMultiFinder = AhoCorasickDense>
+struct MultiPex;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * @class MultiPexPattern
+ * @extends Pattern
+ * @headerfile <seqan/find.h>
+ * @brief Approximate string matching of a dictionary of needles with the Pex filter.
+ *
+ * @signature template <typename TNeedle, typename TMultiFinder>
+ *            class Pattern<TNeedle, MultiPex<TMultiFinder> >;
+ *
+ * @tparam TNeedle      The needle type, a string of keywords. Types: StringSet, String
+ * @tparam TMultiFinder Specifies the algorithm for the multiple exact string matching algorithm.  Types:
+ *                      AhoCorasickDense, AhoCorasick.  Default: AhoCorasickDense.
+ *
+ * Like @link PexPattern @endlink, every keyword is split into k + 1 pieces, one of which occurs without errors in
+ * each occurrence with at most k errors. The pieces of all keywords go into one multiple exact string matching
+ * pattern, so the haystack is scanned once for the whole dictionary, and every piece hit is verified with Myers'
+ * algorithm for its keyword only.
+ *
+ * Each occurrence is reported once by its end position, with its best score, in order of end positions and
+ * keywords; @link MultiPexPattern#position @endlink returns the index of the keyword. Keywords of at most k
+ * characters match everywhere and are never reported.
+ */
+
+template <typename TNeedle, typename TMultiFinder>
+class Pattern<TNeedle, MultiPex<TMultiFinder> >
+{
+//____________________________________________________________________________
+private:
+    Pattern(Pattern const& other);
+    Pattern const& operator=(Pattern const & other);
+
+//____________________________________________________________________________
+public:
+    typedef typename Value<TNeedle>::Type TKeyword;
+    typedef typename Size<TKeyword>::Type TSize;
+    typedef Segment<TKeyword> TPiece;
+    typedef Pattern<TKeyword, MyersUkkonen> TVerifier;
+    typedef Pattern<String<TPiece>, TMultiFinder> TMFinder;
+    // an occurrence by (haystack position of its last character, keyword)
+    typedef std::pair<uint64_t, unsigned> TOccurrence;
+
+    // the maximal accepted error
+    unsigned limit;
+    Holder<TNeedle> data_host;
+
+    // pattern object for the multi pattern search and its needles
+    TMFinder multiPattern;
+    String<TPiece> pieces;
+    String<unsigned> pieceKeyword;      // keyword of each piece
+    String<TSize> pieceStart;           // position of each piece in its keyword
+    String<TVerifier> verifiers;        // one per keyword
+
+    // verified occurrences with their errors, reported once no later piece hit can improve them
+    std::map<TOccurrence, unsigned> pending;
+    uint64_t lastHit;                   // haystack position of the last piece hit
+    uint64_t lastHitEnd;                // and of its last character
+    bool scanning, scanDone, patternNeedsInit;
+
+    unsigned data_keywordIndex;
+    int data_score;
+
+//____________________________________________________________________________
+
+    Pattern() :
+        limit(1), lastHit(0), lastHitEnd(0), scanning(false), scanDone(false), patternNeedsInit(true),
+        data_keywordIndex(0), data_score(0)
+    {}
+
+    template <typename TNeedle2>
+    Pattern(TNeedle2 && ndl, int _limit = -1) :
+        limit(-_limit), lastHit(0), lastHitEnd(0), scanning(false), scanDone(false), patternNeedsInit(true),
+        data_keywordIndex(0), data_score(0)
+    {
+        setHost(*this, std::forward<TNeedle2>(ndl));
+    }
+//____________________________________________________________________________
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename TNeedle, typename TMultiFinder>
+void _reinitPattern(Pattern<TNeedle, MultiPex<TMultiFinder> > & me)
+{
+    // the pieces depend on the score limit, they are built by _patternInit
+    me.patternNeedsInit = true;
+}
+
+template <typename TNeedle, typename TMultiFinder>
+void _patternInit(Pattern<TNeedle, MultiPex<TMultiFinder> > & me)
+{
+    typedef Pattern<TNeedle, MultiPex<TMultiFinder> > TPattern;
+    typedef typename TPattern::TSize TSize;
+
+    TNeedle & ndl = value(me.data_host);
+    unsigned const k = me.limit + 1;
+
+    clear(me.pieces);
+    clear(me.pieceKeyword);
+    clear(me.pieceStart);
+    clear(me.verifiers);
+    resize(me.verifiers, length(ndl));
+    for (unsigned i = 0; i < length(ndl); ++i)
+    {
+        TSize const m = length(ndl[i]);
+        if (m <= me.limit)
+            continue;
+
+        // split into k pieces of about equal length, as Pex does
+        TSize pos = 0;
+        for (unsigned j = 0; j < k; ++j)
+        {
+            TSize const start = pos;
+            pos = m * (j + 1) / k;
+            appendValue(me.pieces, infix(ndl[i], start, pos));
+            appendValue(me.pieceKeyword, i);
+            appendValue(me.pieceStart, start);
+        }
+        setHost(me.verifiers[i], ndl[i]);
+        setScoreLimit(me.verifiers[i], - static_cast<int>(me.limit));
+    }
+    if (!empty(me.pieces))
+        setHost(me.multiPattern, me.pieces);
+    me.patternNeedsInit = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * @fn MultiPexPattern#position
+ * @headerfile <seqan/find.h>
+ * @brief Index of the keyword of the last occurrence found.
+ *
+ * @signature TSize position(pattern);
+ */
+template <typename TNeedle, typename TMultiFinder>
+inline unsigned
+position(Pattern<TNeedle, MultiPex<TMultiFinder> > & me)
+{
+    return me.data_keywordIndex;
+}
+
+template <typename TNeedle, typename TMultiFinder>
+inline int
+getScore(Pattern<TNeedle, MultiPex<TMultiFinder> > & me)
+{
+    return me.data_score;
+}
+
+template <typename TNeedle, typename TMultiFinder>
+inline int
+scoreLimit(Pattern<TNeedle, MultiPex<TMultiFinder> > const & me)
+{
+    return - (int) me.limit;
+}
+
+template <typename TNeedle, typename TScoreValue, typename TMultiFinder>
+inline void
+setScoreLimit(Pattern<TNeedle, MultiPex<TMultiFinder> > & me, TScoreValue _limit)
+{
+    me.patternNeedsInit = true;
+    me.limit = (- _limit);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Verifies the window of the last piece hit for the keyword of the piece.
+template <typename THaystack, typename TNeedle, typename TMultiFinder>
+inline void
+_verifyPieceHit(THaystack & haystack, Pattern<TNeedle, MultiPex<TMultiFinder> > & me, unsigned piece)
+{
+    typedef Segment<THaystack> THaystackSegment;
+    typedef Finder<THaystackSegment> TSegmentFinder;
+
+    unsigned const keyword = me.pieceKeyword[piece];
+    uint64_t const offset = me.pieceStart[piece] + me.limit;
+    uint64_t const start = me.lastHit > offset ? me.lastHit - offset : 0;
+    uint64_t const end = std::min<uint64_t>(me.lastHit - me.pieceStart[piece] + length(value(me.data_host)[keyword]) +
+                                            me.limit, length(haystack));
+
+    THaystackSegment window(infix(haystack, start, end));
+    TSegmentFinder f(window);
+    FUZZY_STATS_ADD(filter_hits, 1);
+    FUZZY_STATS_ADD(verifications, 1);
+    while (find(f, me.verifiers[keyword]))
+    {
+        // an occurrence ending before the piece contains an earlier piece
+        // hit, whose window holds its best alignment
+        uint64_t const last = start + position(f);
+        if (last < me.lastHitEnd)
+            continue;
+        unsigned const errors = - getScore(me.verifiers[keyword]);
+        std::pair<typename std::map<std::pair<uint64_t, unsigned>, unsigned>::iterator, bool> entry =
+                me.pending.insert(std::make_pair(std::make_pair(last, keyword), errors));
+        if (entry.second)
+            FUZZY_STATS_ADD(verifications_passed, 1);
+        else if (errors < entry.first->second)
+            entry.first->second = errors;
+    }
+}
+
+template <typename TFinder, typename TNeedle, typename TMultiFinder>
+inline bool find(TFinder & finder, Pattern<TNeedle, MultiPex<TMultiFinder> > & me)
+{
+    if (empty(finder))
+    {
+        _finderSetNonEmpty(finder);
+        me.pending.clear();
+        me.lastHit = me.lastHitEnd = 0;
+        me.scanning = me.scanDone = false;
+    }
+    if (me.patternNeedsInit)
+        _patternInit(me);
+    if (empty(me.pieces))
+        me.scanDone = true;
+
+    while (true)
+    {
+        // piece hits come by their last character, a later one only finds
+        // occurrences that end at or after it
+        if (!me.pending.empty() && (me.scanDone || me.pending.begin()->first.first < me.lastHitEnd))
+        {
+            me.data_keywordIndex = me.pending.begin()->first.second;
+            me.data_score = - static_cast<int>(me.pending.begin()->second);
+            setPosition(finder, me.pending.begin()->first.first);
+            me.pending.erase(me.pending.begin());
+            _setFinderEnd(finder);
+            return true;
+        }
+        if (me.scanDone)
+            break;
+
+        // the multi pattern finder resumes at the last piece hit
+        TFinder mf(finder);
+        if (me.scanning)
+        {
+            setPosition(mf, me.lastHit);
+        }
+        else
+        {
+            setPosition(mf, 0);
+            clear(mf);
+            me.scanning = true;
+        }
+        if (!find(mf, me.multiPattern))
+        {
+            me.scanDone = true;
+            continue;
+        }
+        unsigned const piece = position(me.multiPattern);
+        me.lastHit = position(mf);
+        me.lastHitEnd = me.lastHit + length(me.pieces[piece]) - 1;
+        _verifyPieceHit(host(finder), me, piece);
+    }
+
+    // set finder to end position
+    setPosition(finder, length(host(finder)));
+    return false;
+}
+
+}// namespace seqan
+
+#endif //#ifndef SEQAN_HEADER_FIND_MULTI_PEX_H
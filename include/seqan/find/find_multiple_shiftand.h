@@ -35,6 +35,13 @@
 #ifndef SEQAN_HEADER_FIND_MULTIPLESHIFTAND_H
 #define SEQAN_HEADER_FIND_MULTIPLESHIFTAND_H
 
+// The AVX2 kernel is compiled for the instruction set with a function
+// attribute and picked at runtime, so the header needs no -mavx2.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SEQAN_MULTIPLE_SHIFTAND_AVX2 1
+#include <immintrin.h>
+#endif
+
 namespace seqan
 {
 
@@ -48,7 +55,12 @@ namespace seqan
  * @headerfile <seqan/find.h>
  * @brief Multiple exact string matching using bit parallelism.
  *
- * The total size of the patterns should fit into a computer word.
+ * The keywords are concatenated into one bit vector of 64-bit words. Each
+ * haystack character shifts the vector and masks it with the word block of
+ * the character, which the table keeps contiguously. Vectors of more than one
+ * word are updated 256 bits per instruction with AVX2 on CPUs that support
+ * it, so the cost per character is about the total length of the keywords
+ * divided by 64, or by 256 with AVX2.
  *
  * @signature template <typename TNeedle>
  *            class Pattern<TNeedle, MultipleShiftAnd>;
@@ -56,6 +68,7 @@ namespace seqan
  * @tparam TNeedle The needle type, a string of keywords. Types: String
  *
  * The types of all keywords in the needle and the haystack have to match.
+ * Empty keywords are never found.
  */
 
 struct MultipleShiftAnd_;
@@ -72,47 +85,35 @@ private:
 
 //____________________________________________________________________________
 public:
-    typedef unsigned int TWord;
+    typedef uint64_t TWord;
     typedef typename Size<TNeedle>::Type TSize;
     Holder<TNeedle> data_host;
-    TWord* table;            // Look up table for each character in the alphabet (called B in "Navarro")
-    TWord* prefSufMatch;    // Set of all the prefixes of needle that match a suffix of haystack (called D in "Navarro")
-    TWord* di;                // Initialization word
-    TWord* df;                // Final test word
-    TWord alphabetSize;        // e.g., char --> 256
-    TWord totalLength;        // Lenght of concatenated keywords
-    TWord blockCount;        // #unsigned ints required to store needle
+    String<TWord> table;          // Look up table, stride words per character of the alphabet (called B in "Navarro")
+    String<TWord> prefSufMatch;   // Set of all the prefixes of needle that match a suffix of haystack (called D in "Navarro")
+    String<TWord> di;             // Initialization word
+    String<TWord> df;             // Final test word
+    String<TSize> endKeyword;     // Keyword that ends at each bit set in df
+    unsigned alphabetSize;        // e.g., char --> 256
+    TSize totalLength;            // Length of concatenated keywords
+    unsigned blockCount;          // #words required to store needle
+    unsigned stride;              // blockCount rounded up to the width of the kernel
+    bool avx2;                    // the AVX2 kernel updates the words
     std::deque<Pair<TSize, TSize> > data_keyword;  // All keywords that produced a hit here
     TSize data_keywordIndex;  // Last keyword index
     TSize data_needleLength;  // Last needle length
 
 //____________________________________________________________________________
 
-    Pattern() {
-        table = 0;
-        prefSufMatch=0;
-        di = 0;
-        df = 0;
-    }
+    Pattern() : alphabetSize(0), totalLength(0), blockCount(0), stride(0), avx2(false),
+                data_keywordIndex(0), data_needleLength(0)
+    {}
 
     template <typename TNeedle2>
-    Pattern(TNeedle2 const & ndl)
+    Pattern(TNeedle2 const & ndl) : alphabetSize(0), totalLength(0), blockCount(0), stride(0), avx2(false),
+                                    data_keywordIndex(0), data_needleLength(0)
     {
-        table = 0;
-        prefSufMatch=0;
-        di = 0;
-        df = 0;
         setHost(*this, ndl);
     }
-
-    ~Pattern() {
-        if (table != 0) {
-            deallocate(this, table, alphabetSize * blockCount);
-            deallocate(this, prefSufMatch, blockCount);
-            deallocate(this, di, blockCount);
-            deallocate(this, df, blockCount);
-        }
-    }
 //____________________________________________________________________________
 };
 
@@ -136,16 +137,24 @@ struct Host< Pattern<TNeedle, MultipleShiftAnd> const>
 // Functions
 //////////////////////////////////////////////////////////////////////////////
 
+// Whether the CPU runs the AVX2 kernel, checked once.
+inline bool _multipleShiftAndHasAvx2()
+{
+#ifdef SEQAN_MULTIPLE_SHIFTAND_AVX2
+    static bool const supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+    return supported;
+#else
+    return false;
+#endif
+}
+
 template <typename TNeedle, typename TNeedle2>
 void setHost (Pattern<TNeedle, MultipleShiftAnd> & me, TNeedle2 const & needle) {
-    typedef unsigned int TWord;
+    typedef typename Pattern<TNeedle, MultipleShiftAnd>::TWord TWord;
+    typedef typename Pattern<TNeedle, MultipleShiftAnd>::TSize TSize;
     typedef typename Value<TNeedle>::Type TKeyword;
     typedef typename Value<TKeyword>::Type TAlphabet;
-    if (me.table != 0) {
-        deallocate(me, me.table, me.alphabetSize * me.blockCount);
-        deallocate(me, me.di, me.blockCount);
-        deallocate(me, me.df, me.blockCount);
-    }
+    unsigned const bits = BitsPerValue<TWord>::VALUE;
 
     typename Iterator<TNeedle2 const, Rooted>::Type it = begin(needle);
     me.totalLength = 0;
@@ -154,69 +163,40 @@ void setHost (Pattern<TNeedle, MultipleShiftAnd> & me, TNeedle2 const & needle)
     }
     me.alphabetSize = ValueSize<TAlphabet>::VALUE;
     if (me.totalLength<1) me.blockCount=1;
-    else me.blockCount=((me.totalLength-1) / BitsPerValue<TWord>::VALUE)+1;
-
-    allocate (me, me.table, me.blockCount * me.alphabetSize);
-    arrayFill (me.table, me.table + me.blockCount * me.alphabetSize, 0);
-
-    allocate (me, me.di, me.blockCount);
-    arrayFill (me.di, me.di + me.blockCount, 0);
-
-    allocate (me, me.df, me.blockCount);
-    arrayFill (me.df, me.df + me.blockCount, 0);
+    else me.blockCount=((me.totalLength-1) / bits)+1;
+
+    // The AVX2 kernel updates four words at once, the words it pads the
+    // vector with stay zero as their table entries are.
+    me.avx2 = me.blockCount > 1 && _multipleShiftAndHasAvx2();
+    me.stride = me.avx2 ? (me.blockCount + 3) / 4 * 4 : me.blockCount;
+
+    clear(me.table);
+    resize(me.table, (size_t)me.stride * me.alphabetSize, 0, Exact());
+    clear(me.di);
+    resize(me.di, me.stride, 0, Exact());
+    clear(me.df);
+    resize(me.df, me.stride, 0, Exact());
+    clear(me.prefSufMatch);
+    resize(me.prefSufMatch, me.stride, 0, Exact());
+    clear(me.endKeyword);
+    resize(me.endKeyword, me.totalLength, 0, Exact());
 
     goBegin(it);
-    TWord j = 0;
+    TSize j = 0;
     for(;!atEnd(it);goNext(it)) {
-        me.di[j / BitsPerValue<TWord>::VALUE] |= (1<<(j%BitsPerValue<TWord>::VALUE));
-        for (TWord posInKeyword = 0; posInKeyword < length(*it); ++posInKeyword) {
+        if (empty(*it))
+            continue;
+        me.di[j / bits] |= (TWord)1 << (j % bits);
+        for (TSize posInKeyword = 0; posInKeyword < length(*it); ++posInKeyword) {
             // Determine character position in array table
-            TWord index = convert<TWord>(getValue(*it,posInKeyword));
-            me.table[me.blockCount*index + j / BitsPerValue<TWord>::VALUE] |= (1<<(j%BitsPerValue<TWord>::VALUE));
+            unsigned index = ordValue(getValue(*it,posInKeyword));
+            me.table[(size_t)me.stride*index + j / bits] |= (TWord)1 << (j % bits);
             ++j;
         }
-        me.df[(j - 1) / BitsPerValue<TWord>::VALUE] |= (1<<((j-1)%BitsPerValue<TWord>::VALUE));
+        me.df[(j - 1) / bits] |= (TWord)1 << ((j - 1) % bits);
+        me.endKeyword[j - 1] = position(it);
     }
     setValue(me.data_host, needle);
-
-    /*
-    // Debug code
-    std::cout << "Alphabet size: " << me.alphabetSize << std::endl;
-    std::cout << "Needle length: " << me.totalLength << std::endl;
-    std::cout << "Block count: " << me.blockCount << std::endl;
-    std::cout << "K: ";
-    goBegin(it);
-    for(;!atEnd(it);goNext(it)) {
-        std::cout << *it;
-    }
-    std::cout << std::endl;
-    std::cout << "Table: " << std::endl;
-    for(unsigned int i=0;i<me.alphabetSize;++i) {
-        //if ((i<97) || (i>122)) continue;
-        std::cout << TAlphabet(i) << ": ";
-        for(int j=0;j<me.blockCount;++j) {
-            for(int bit_pos=0;bit_pos<BitsPerValue<unsigned int>::VALUE;++bit_pos) {
-                std::cout << ((me.table[me.blockCount*i+j] & (1<<(bit_pos % BitsPerValue<unsigned int>::VALUE))) !=0);
-            }
-        }
-        std::cout << std::endl;
-    }
-    std::cout << "DI and DF: " << std::endl;
-    std::cout << "I: ";
-    for(int j=0;j<me.blockCount;++j) {
-        for(int bit_pos=0;bit_pos<BitsPerValue<unsigned int>::VALUE;++bit_pos) {
-            std::cout << ((me.di[j] & (1<<(bit_pos % BitsPerValue<unsigned int>::VALUE))) !=0);
-        }
-    }
-    std::cout << std::endl;
-    std::cout << "F: ";
-    for(int j=0;j<me.blockCount;++j) {
-        for(int bit_pos=0;bit_pos<BitsPerValue<unsigned int>::VALUE;++bit_pos) {
-            std::cout << ((me.df[j] & (1<<(bit_pos % BitsPerValue<unsigned int>::VALUE))) !=0);
-        }
-    }
-    std::cout << std::endl;
-    */
 }
 
 template <typename TNeedle, typename TNeedle2>
@@ -231,10 +211,7 @@ void setHost (Pattern<TNeedle, MultipleShiftAnd> & me, TNeedle2 & needle)
 template <typename TNeedle>
 inline void _patternInit (Pattern<TNeedle, MultipleShiftAnd> & me)
 {
-    if (me.prefSufMatch != 0)
-        deallocate(me, me.prefSufMatch, me.blockCount);
-    allocate (me, me.prefSufMatch, me.blockCount);
-    arrayFill (me.prefSufMatch, me.prefSufMatch + me.blockCount, 0);
+    arrayFill (begin(me.prefSufMatch, Standard()), end(me.prefSufMatch, Standard()), 0);
     me.data_keyword.clear();
     me.data_keywordIndex = 0;
 }
@@ -265,133 +242,159 @@ position(Pattern<TNeedle, MultipleShiftAnd> & me)
     return me.data_keywordIndex;
 }
 
+// Queues the keywords ending at the current haystack character, in the order
+// of the needle, and reports the first one.
+template <typename TFinder, typename TNeedle>
+inline void _reportShiftAndMatches(TFinder & finder, Pattern<TNeedle, MultipleShiftAnd> & me) {
+    typedef typename Pattern<TNeedle, MultipleShiftAnd>::TWord TWord;
+    typedef typename Pattern<TNeedle, MultipleShiftAnd>::TSize TSize;
+    for (unsigned block = 0; block < me.blockCount; ++block) {
+        TWord hits = me.prefSufMatch[block] & me.df[block];
+        while (hits != 0) {
+            TSize keyword = me.endKeyword[(TSize)block * BitsPerValue<TWord>::VALUE + bitScanForward(hits)];
+            me.data_keyword.push_back(Pair<TSize,TSize>(keyword, length(value(host(me), keyword))));
+            hits &= hits - 1;
+        }
+    }
+    me.data_keywordIndex = (me.data_keyword.front()).i1;
+    me.data_needleLength = (me.data_keyword.front()).i2;
+    me.data_keyword.pop_front();
+    _setFinderEnd(finder);
+    _setFinderLength(finder, me.data_needleLength);
+    finder -= (me.data_needleLength - 1);
+}
 
 template <typename TFinder, typename TNeedle>
 bool _findShiftAndSmallNeedle(TFinder & finder, Pattern<TNeedle, MultipleShiftAnd> & me) {
-    typedef unsigned int TWord;
-    typedef typename Size<TNeedle>::Type TSize;
+    typedef typename Pattern<TNeedle, MultipleShiftAnd>::TWord TWord;
+    TWord const * table = begin(me.table, Standard());
+    TWord const di = me.di[0];
+    TWord const df = me.df[0];
+    TWord prefSufMatch = me.prefSufMatch[0];
     while (!atEnd(finder)) {
-        TWord pos = convert<TWord>(*finder);
-        me.prefSufMatch[0] = ((me.prefSufMatch[0] << 1) | me.di[0]) & me.table[me.blockCount*pos];
-
-        /*
-        // Debug code
-        std::cout << "   ";
-        for(int j=0;j<me.blockCount;++j) {
-            for(int bit_pos=0;bit_pos<BitsPerValue<unsigned int>::VALUE;++bit_pos) {
-                std::cout << ((me.prefSufMatch[j] & (1<<(bit_pos % BitsPerValue<unsigned int>::VALUE))) !=0);
-            }
-        }
-        std::cout << std::endl;
-        */
-
-        if ((me.prefSufMatch[0] & me.df[0]) != 0) {
-            // Check which pattern has matched
-            typename Iterator<TNeedle, Rooted>::Type it = begin(value(me.data_host));
-            TWord j = 0;
-            for(;!atEnd(it);goNext(it)) {
-                j += length(*it);
-                TWord test = (1<<((j-1)%BitsPerValue<TWord>::VALUE));
-                /*
-                // Debug code
-                std::cout << "Tes";
-                for(int j=0;j<me.blockCount;++j) {
-                    for(int bit_pos=0;bit_pos<BitsPerValue<unsigned int>::VALUE;++bit_pos) {
-                        std::cout << ((test & (1<<(bit_pos % BitsPerValue<unsigned int>::VALUE))) !=0);
-                    }
-                }
-                std::cout << std::endl;
-                */
-                if ((me.prefSufMatch[0] & test) != 0) {
-                    me.data_keyword.push_back(Pair<TSize,TSize>(position(it),length(*it)));
-                }
-            }
-            me.data_keywordIndex = (me.data_keyword.front()).i1;
-            me.data_needleLength = (me.data_keyword.front()).i2;
-            me.data_keyword.pop_front();
-            _setFinderEnd(finder);
-            _setFinderLength(finder, me.data_needleLength);
-            finder -= (me.data_needleLength - 1);
+        prefSufMatch = ((prefSufMatch << 1) | di) & table[ordValue(*finder)];
+        if ((prefSufMatch & df) != 0) {
+            me.prefSufMatch[0] = prefSufMatch;
+            _reportShiftAndMatches(finder, me);
             return true;
         }
         goNext(finder);
     }
+    me.prefSufMatch[0] = prefSufMatch;
     return false;
 }
 
 template <typename TFinder, typename TNeedle>
 bool _findShiftAndLargeNeedle(TFinder & finder, Pattern<TNeedle, MultipleShiftAnd> & me) {
-    typedef typename Size<TNeedle>::Type TSize;
-    typedef unsigned int TWord;
+    typedef typename Pattern<TNeedle, MultipleShiftAnd>::TWord TWord;
+    unsigned const msb = BitsPerValue<TWord>::VALUE - 1;
+    TWord * prefSufMatch = begin(me.prefSufMatch, Standard());
+    TWord const * di = begin(me.di, Standard());
+    TWord const * df = begin(me.df, Standard());
     while (!atEnd(finder)) {
-        TWord pos = convert<TWord>(*finder);
-        TWord carry = 1;
-        for(TWord block=0;block<me.blockCount;++block) {
-            bool newCarry = ((me.prefSufMatch[block] & (1<< (BitsPerValue<TWord>::VALUE - 1)))!=0);
-            me.prefSufMatch[block]<<=1;
-            me.prefSufMatch[block]|=carry;
-            carry = newCarry;
+        // shift, initialize, mask and test in one pass over the words
+        TWord const * table = begin(me.table, Standard()) + (size_t)me.stride * ordValue(*finder);
+        TWord carry = 0;
+        TWord match = 0;
+        for (unsigned block = 0; block < me.blockCount; ++block) {
+            TWord const word = prefSufMatch[block];
+            prefSufMatch[block] = ((word << 1) | carry | di[block]) & table[block];
+            carry = word >> msb;
+            match |= prefSufMatch[block] & df[block];
         }
-        for(TWord block=0;block<me.blockCount;++block) me.prefSufMatch[block] |= me.di[block];
-        for(TWord block=0;block<me.blockCount;++block) me.prefSufMatch[block] &= me.table[me.blockCount*pos+block];
-
-        /*
-        // Debug code
-        std::cout << "   ";
-        for(int j=0;j<me.blockCount;++j) {
-            for(int bit_pos=0;bit_pos<BitsPerValue<unsigned int>::VALUE;++bit_pos) {
-                std::cout << ((me.prefSufMatch[j] & (1<<(bit_pos % BitsPerValue<unsigned int>::VALUE))) !=0);
-            }
+        if (match != 0) {
+            _reportShiftAndMatches(finder, me);
+            return true;
         }
-        std::cout << std::endl;
-        */
-
-        bool match = false;
-        for(TWord block=0;block<me.blockCount;++block) {
-            if ((me.prefSufMatch[block] & me.df[block]) != 0) {
-                match = true;
-                break;
-            }
+        goNext(finder);
+    }
+    return false;
+}
+
+#ifdef SEQAN_MULTIPLE_SHIFTAND_AVX2
+// One AVX2 step of the large needle loop on four words. The bit a word shifts
+// out moves to the next 64-bit lane, and from the last lane into the first
+// lane of the next vector through carry.
+__attribute__((target("avx2")))
+inline __m256i _shiftAndStepAvx2(__m256i word, __m256i & carry, __m256i di, __m256i table)
+{
+    __m256i const zero = _mm256_setzero_si256();
+    // lane i receives the top bit of lane i - 1, lane 0 that of lane 3
+    __m256i const top = _mm256_permute4x64_epi64(_mm256_srli_epi64(word, 63), _MM_SHUFFLE(2, 1, 0, 3));
+    __m256i const shifted = _mm256_or_si256(_mm256_slli_epi64(word, 1), _mm256_blend_epi32(top, carry, 0x03));
+    carry = _mm256_blend_epi32(zero, top, 0x03);
+    return _mm256_and_si256(_mm256_or_si256(shifted, di), table);
+}
+
+// The large needle loop for up to VECTORS * 256 bits, held in registers.
+template <unsigned VECTORS, typename TFinder, typename TNeedle>
+__attribute__((target("avx2")))
+bool _findShiftAndRegistersAvx2(TFinder & finder, Pattern<TNeedle, MultipleShiftAnd> & me) {
+    typedef typename Pattern<TNeedle, MultipleShiftAnd>::TWord TWord;
+    TWord * prefSufMatch = begin(me.prefSufMatch, Standard());
+    TWord const * tables = begin(me.table, Standard());
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i word[VECTORS], di[VECTORS], df[VECTORS];
+    for (unsigned v = 0; v < VECTORS; ++v) {
+        word[v] = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(prefSufMatch + 4 * v));
+        di[v] = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin(me.di, Standard()) + 4 * v));
+        df[v] = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(begin(me.df, Standard()) + 4 * v));
+    }
+    bool found = false;
+    while (!atEnd(finder)) {
+        TWord const * table = tables + (size_t)me.stride * ordValue(*finder);
+        __m256i carry = zero;
+        __m256i match = zero;
+        for (unsigned v = 0; v < VECTORS; ++v) {
+            word[v] = _shiftAndStepAvx2(word[v], carry, di[v],
+                                        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(table + 4 * v)));
+            match = _mm256_or_si256(match, _mm256_and_si256(word[v], df[v]));
+        }
+        if (!_mm256_testz_si256(match, match)) {
+            found = true;
+            break;
+        }
+        goNext(finder);
+    }
+    for (unsigned v = 0; v < VECTORS; ++v)
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(prefSufMatch + 4 * v), word[v]);
+    if (found)
+        _reportShiftAndMatches(finder, me);
+    return found;
+}
+
+// The large needle loop for any length, with the words in memory.
+template <typename TFinder, typename TNeedle>
+__attribute__((target("avx2")))
+bool _findShiftAndLargeNeedleAvx2(TFinder & finder, Pattern<TNeedle, MultipleShiftAnd> & me) {
+    typedef typename Pattern<TNeedle, MultipleShiftAnd>::TWord TWord;
+    TWord * prefSufMatch = begin(me.prefSufMatch, Standard());
+    TWord const * di = begin(me.di, Standard());
+    TWord const * df = begin(me.df, Standard());
+    TWord const * tables = begin(me.table, Standard());
+    __m256i const zero = _mm256_setzero_si256();
+    while (!atEnd(finder)) {
+        TWord const * table = tables + (size_t)me.stride * ordValue(*finder);
+        __m256i carry = zero;
+        __m256i match = zero;
+        for (unsigned block = 0; block < me.stride; block += 4) {
+            __m256i const next = _shiftAndStepAvx2(
+                    _mm256_loadu_si256(reinterpret_cast<__m256i const *>(prefSufMatch + block)), carry,
+                    _mm256_loadu_si256(reinterpret_cast<__m256i const *>(di + block)),
+                    _mm256_loadu_si256(reinterpret_cast<__m256i const *>(table + block)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(prefSufMatch + block), next);
+            match = _mm256_or_si256(match, _mm256_and_si256(next,
+                    _mm256_loadu_si256(reinterpret_cast<__m256i const *>(df + block))));
         }
-        if (match) {
-            // Check which pattern has matched
-            typename Iterator<TNeedle, Rooted>::Type it = begin(value(me.data_host));
-            TWord j = 0;
-            for(;!atEnd(it);goNext(it)) {
-                j += length(*it);
-                TWord* test;
-                allocate (me, test, me.blockCount);
-                arrayFill (test, test + me.blockCount, 0);
-                test[(j - 1) / BitsPerValue<TWord>::VALUE] |= (1<<((j-1)%BitsPerValue<TWord>::VALUE));
-
-                /*
-                // Debug code
-                std::cout << "Tes";
-                for(int i=0;i<me.blockCount;++i) {
-                    for(int bit_pos=0;bit_pos<BitsPerValue<unsigned int>::VALUE;++bit_pos) {
-                        std::cout << ((test[i] & (1<<(bit_pos % BitsPerValue<unsigned int>::VALUE))) !=0);
-                    }
-                }
-                std::cout << std::endl;
-                */
-
-                if ((me.prefSufMatch[(j - 1) / BitsPerValue<TWord>::VALUE] & test[(j - 1) / BitsPerValue<TWord>::VALUE]) != 0) {
-                    me.data_keyword.push_back(Pair<TSize,TSize>(position(it),length(*it)));
-                }
-                deallocate(me, test, me.blockCount);
-            }
-            me.data_keywordIndex = (me.data_keyword.front()).i1;
-            me.data_needleLength = (me.data_keyword.front()).i2;
-            me.data_keyword.pop_front();
-            _setFinderEnd(finder);
-            _setFinderLength(finder, me.data_needleLength);
-            finder -= (me.data_needleLength - 1);
+        if (!_mm256_testz_si256(match, match)) {
+            _reportShiftAndMatches(finder, me);
             return true;
         }
         goNext(finder);
     }
     return false;
 }
+#endif
 
 template <typename TFinder, typename TNeedle>
 inline bool find(TFinder & finder, Pattern<TNeedle, MultipleShiftAnd> & me) {
@@ -403,6 +406,7 @@ inline bool find(TFinder & finder, Pattern<TNeedle, MultipleShiftAnd> & me) {
         me.data_keywordIndex = (me.data_keyword.front()).i1;
         me.data_needleLength = (me.data_keyword.front()).i2;
         me.data_keyword.pop_front();
+        _setFinderLength(finder, me.data_needleLength);
         finder -= (me.data_needleLength - 1);
         return true;
     }
@@ -417,9 +421,17 @@ inline bool find(TFinder & finder, Pattern<TNeedle, MultipleShiftAnd> & me) {
     // Fast algorithm for needles < machine word?
     if (me.blockCount == 1) {
         return _findShiftAndSmallNeedle(finder, me);
-    } else {
-        return _findShiftAndLargeNeedle(finder, me);
     }
+#ifdef SEQAN_MULTIPLE_SHIFTAND_AVX2
+    if (me.avx2) {
+        switch (me.stride) {
+            case 4: return _findShiftAndRegistersAvx2<1>(finder, me);
+            case 8: return _findShiftAndRegistersAvx2<2>(finder, me);
+            default: return _findShiftAndLargeNeedleAvx2(finder, me);
+        }
+    }
+#endif
+    return _findShiftAndLargeNeedle(finder, me);
 }
 
 }// namespace seqan
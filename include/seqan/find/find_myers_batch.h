@@ -0,0 +1,283 @@
+// ==========================================================================
+//                 SeqAn - The Library for Sequence Analysis
+// ==========================================================================
+// Copyright (c) 2006-2016, Knut Reinert, FU Berlin
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Knut Reinert or the FU Berlin nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL KNUT REINERT OR THE FU BERLIN BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+// OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+// DAMAGE.
+//
+// ==========================================================================
+// Myers' algorithm on many (needle, haystack) pairs at once, one per SIMD lane.
+// ==========================================================================
+
+#ifndef SEQAN_HEADER_FIND_MYERS_BATCH_H
+#define SEQAN_HEADER_FIND_MYERS_BATCH_H
+
+// The SIMD kernels are compiled for their instruction set with a function
+// attribute and picked at runtime, so the header needs no -mavx2.
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SEQAN_MYERS_BATCH_SIMD 1
+#endif
+
+namespace seqan
+{
+
+// ============================================================================
+// Forwards
+// ============================================================================
+
+#ifdef SEQAN_MYERS_BATCH_SIMD
+// the lanes of an AVX2 and of an AVX-512 register
+typedef uint32_t MyersBatch8x32_ __attribute__((vector_size(32)));
+typedef uint64_t MyersBatch4x64_ __attribute__((vector_size(32)));
+typedef uint32_t MyersBatch16x32_ __attribute__((vector_size(64)));
+typedef uint64_t MyersBatch8x64_ __attribute__((vector_size(64)));
+#endif
+
+// ============================================================================
+// Functions
+// ============================================================================
+
+// The widest kernel the CPU runs, checked once: 2 for AVX-512, 1 for AVX2, 0 for none.
+inline int
+_myersBatchSimdLevel()
+{
+#ifdef SEQAN_MYERS_BATCH_SIMD
+    static int const level = (__builtin_cpu_init(),
+                              __builtin_cpu_supports("avx512f") ? 2 : __builtin_cpu_supports("avx2") ? 1 : 0);
+    return level;
+#else
+    return 0;
+#endif
+}
+
+// Verifies one pair with the Myers pattern: the best score over all end positions and the first end with it.
+template <typename TScores, typename TEnds, typename TNeedle, typename THaystack>
+inline void
+_myersBatchPair(TScores & scores, TEnds & ends, unsigned pair, TNeedle const & needle, THaystack const & haystack)
+{
+    int const m = length(needle);
+    scores[pair] = - m;
+    ends[pair] = 0;
+    if (m == 0 || empty(haystack))
+        return;
+
+    String<typename Value<TNeedle const>::Type> ndl(needle);
+    Pattern<String<typename Value<TNeedle const>::Type>, Myers<> > pattern(ndl);
+    THaystack & hstk = const_cast<THaystack &>(haystack);
+    Finder<THaystack> finder(hstk);
+    bool first = true;
+    while (find(finder, pattern, - m))
+    {
+        if (first || getScore(pattern) > scores[pair])
+        {
+            scores[pair] = getScore(pattern);
+            ends[pair] = endPosition(finder);
+            first = false;
+            if (scores[pair] == 0)
+                break;
+        }
+    }
+}
+
+#ifdef SEQAN_MYERS_BATCH_SIMD
+
+// Runs the pairs at the given indices, LANES at a time in a vector of TWord
+// lanes. A lane takes the next pair when its haystack is exhausted or its
+// needle matched without errors.
+template <typename TWord, typename TVector, unsigned LANES,
+          typename TScores, typename TEnds, typename TNeedles, typename THaystacks, typename TPairs>
+inline __attribute__((always_inline)) void
+_myersBatchLanes(TScores & scores, TEnds & ends, TNeedles const & needles, THaystacks const & haystacks,
+                 TPairs const & pairs)
+{
+    typedef typename Value<THaystacks const>::Type THaystack;
+    typedef typename Iterator<THaystack const, Standard>::Type THaystackIter;
+    typedef typename Value<typename Value<TNeedles const>::Type>::Type TAlphabet;
+
+    unsigned const sigma = ValueSize<TAlphabet>::VALUE;
+    // a row of bit masks per lane and one zero word for idle lanes
+    String<TWord> table;
+    resize(table, LANES * sigma + 1, 0, Exact());
+    unsigned const idle = LANES * sigma;
+
+    unsigned pair[LANES];
+    THaystackIter it[LANES], itEnd[LANES];
+    bool active[LANES];
+    TVector const none = TVector();
+    TVector const one = none + 1;
+    TVector vp = none, vn = none, score = none, best = none, bestEnd = none, step = none, lastBit = none;
+
+    unsigned next = 0, running = 0;
+    for (unsigned l = 0; l < LANES; ++l)
+    {
+        active[l] = false;
+        it[l] = itEnd[l] = THaystackIter();
+    }
+
+    while (true)
+    {
+        TWord zero[LANES];
+        for (unsigned l = 0; l < LANES; ++l)
+            zero[l] = best[l] == 0;
+
+        TVector eq = none;
+        for (unsigned l = 0; l < LANES; ++l)
+        {
+            if (it[l] == itEnd[l] || (active[l] && zero[l]))
+            {
+                if (active[l])
+                {
+                    // retire the pair and clear its row
+                    scores[pair[l]] = - static_cast<int>(best[l]);
+                    ends[pair[l]] = bestEnd[l];
+                    typename Value<TNeedles const>::Type const & needle = needles[pair[l]];
+                    for (unsigned j = 0; j < length(needle); ++j)
+                        table[l * sigma + ordValue(needle[j])] = 0;
+                    active[l] = false;
+                    --running;
+                }
+                if (next < length(pairs))
+                {
+                    pair[l] = pairs[next++];
+                    typename Value<TNeedles const>::Type const & needle = needles[pair[l]];
+                    unsigned const m = length(needle);
+                    for (unsigned j = 0; j < m; ++j)
+                        table[l * sigma + ordValue(needle[j])] |= static_cast<TWord>(1) << j;
+                    it[l] = begin(haystacks[pair[l]], Standard());
+                    itEnd[l] = end(haystacks[pair[l]], Standard());
+                    vp[l] = ~static_cast<TWord>(0);
+                    vn[l] = 0;
+                    score[l] = m;
+                    best[l] = m + 1;
+                    bestEnd[l] = step[l] = 0;
+                    lastBit[l] = static_cast<TWord>(1) << (m - 1);
+                    active[l] = true;
+                    ++running;
+                }
+            }
+            if (active[l])
+            {
+                eq[l] = table[l * sigma + ordValue(*it[l])];
+                ++it[l];
+            }
+            else
+            {
+                eq[l] = table[idle];
+            }
+        }
+        if (running == 0)
+            break;
+
+        // one column of Myers' algorithm in every lane
+        TVector x = eq | vn;
+        TVector d0 = (((x & vp) + vp) ^ vp) | x;
+        TVector hn = vp & d0;
+        TVector hp = vn | ~(vp | d0);
+        x = hp << 1;
+        vn = x & d0;
+        vp = (hn << 1) | ~(x | d0);
+
+        step += one;
+        score -= (TVector)((hp & lastBit) != 0);
+        score += (TVector)((hn & lastBit) != 0);
+        TVector improved = (TVector)(score < best);
+        best = (score & improved) | (best & ~improved);
+        bestEnd = (step & improved) | (bestEnd & ~improved);
+    }
+}
+
+template <typename TScores, typename TEnds, typename TNeedles, typename THaystacks, typename TPairs>
+__attribute__((target("avx2"))) void
+_myersBatchAvx2(TScores & scores, TEnds & ends, TNeedles const & needles, THaystacks const & haystacks,
+                TPairs const & narrow, TPairs const & wide)
+{
+    _myersBatchLanes<uint32_t, MyersBatch8x32_, 8>(scores, ends, needles, haystacks, narrow);
+    _myersBatchLanes<uint64_t, MyersBatch4x64_, 4>(scores, ends, needles, haystacks, wide);
+}
+
+template <typename TScores, typename TEnds, typename TNeedles, typename THaystacks, typename TPairs>
+__attribute__((target("avx512f"))) void
+_myersBatchAvx512(TScores & scores, TEnds & ends, TNeedles const & needles, THaystacks const & haystacks,
+                  TPairs const & narrow, TPairs const & wide)
+{
+    _myersBatchLanes<uint32_t, MyersBatch16x32_, 16>(scores, ends, needles, haystacks, narrow);
+    _myersBatchLanes<uint64_t, MyersBatch8x64_, 8>(scores, ends, needles, haystacks, wide);
+}
+
+#endif  // #ifdef SEQAN_MYERS_BATCH_SIMD
+
+/*!
+ * @fn myersBatchScores
+ * @headerfile <seqan/find.h>
+ * @brief Verifies many (needle, haystack) pairs with Myers' algorithm, several pairs per SIMD register.
+ *
+ * @signature void myersBatchScores(scores, endPositions, needles, haystacks);
+ *
+ * @param[out] scores       The best score of each pair, the negated edit distance of the needle to the closest
+ *                          infix of the haystack. Types: String of int
+ * @param[out] endPositions The end position of the first infix with the best score of each pair, one past its last
+ *                          character, 0 if the haystack is empty. Types: String
+ * @param[in]  needles      The needles. Types: StringSet
+ * @param[in]  haystacks    The haystacks, as many as needles. Types: StringSet
+ *
+ * This is what a @link MyersPattern @endlink finder reports as the best over the end positions of the haystack,
+ * for many short pairs such as reads and the windows they may map to. On CPUs with AVX2 or AVX-512, needles of up
+ * to 32 characters are verified 8 or 16 pairs at a time in 32-bit lanes, needles of up to 64 characters 4 or 8 at
+ * a time in 64-bit lanes. A lane takes the next pair as soon as its haystack is exhausted or its needle matched
+ * without errors, so pairs of different lengths keep all lanes busy. Longer needles are verified one by one.
+ */
+template <typename TScores, typename TEnds, typename TNeedles, typename THaystacks>
+inline void
+myersBatchScores(TScores & scores, TEnds & endPositions, TNeedles const & needles, THaystacks const & haystacks)
+{
+    SEQAN_ASSERT_EQ(length(needles), length(haystacks));
+    resize(scores, length(needles), Exact());
+    resize(endPositions, length(needles), Exact());
+
+    int const level = _myersBatchSimdLevel();
+    String<unsigned> narrow, wide;
+    for (unsigned i = 0; i < length(needles); ++i)
+    {
+        uint64_t const m = length(needles[i]), n = length(haystacks[i]);
+        if (level != 0 && m != 0 && m <= 32 && n != 0 && n < (static_cast<uint64_t>(1) << 32))
+            appendValue(narrow, i);
+        else if (level != 0 && m != 0 && m <= 64 && n != 0)
+            appendValue(wide, i);
+        else
+            _myersBatchPair(scores, endPositions, i, needles[i], haystacks[i]);
+    }
+
+#ifdef SEQAN_MYERS_BATCH_SIMD
+    if (level == 2)
+        _myersBatchAvx512(scores, endPositions, needles, haystacks, narrow, wide);
+    else if (level == 1)
+        _myersBatchAvx2(scores, endPositions, needles, haystacks, narrow, wide);
+#endif
+}
+
+}  // namespace seqan
+
+#endif  // #ifndef SEQAN_HEADER_FIND_MYERS_BATCH_H
@@ -240,8 +240,9 @@ struct MyersLargeState_
     String<TWord> VP;
     String<TWord> VN;
     TWord scoreMask;            // the mask with a bit set at the position of the last active cell
+    unsigned wideBlocks;        // the blocks computed as one wide word, 0 if the column is banded
 
-    MyersLargeState_() : lastBlock(0), scoreMask(0) {}
+    MyersLargeState_() : lastBlock(0), scoreMask(0), wideBlocks(0) {}
 };
 template <typename TNeedle, typename TSpec, typename TFinderCSP, typename TPatternCSP>
 struct MyersLargeState_<TNeedle, AlignTextBanded<TSpec, TFinderCSP, TPatternCSP> >
@@ -391,6 +392,7 @@ struct MyersLargePattern_
 
     unsigned blockCount;        // the number of blocks
     TWord finalScoreMask;        // a mask with a bit set on the position of the last row
+    unsigned letterCount;       // the number of different letters in the needle
 };
 template <typename TNeedle, typename TSpec, typename TFinderCSP, typename TPatternCSP>
 struct MyersLargePattern_<TNeedle, AlignTextBanded<TSpec, TFinderCSP, TPatternCSP> > {};
@@ -555,6 +557,19 @@ inline void _patternFirstInit(Pattern<TNeedle, Myers<TSpec, THasState, TFindBegi
         ] |= (TWord)1 << (j % pattern.MACHINE_WORD_SIZE);
         //pattern.bitMasks[pattern.blockCount * ordValue((CompareType< Value< TNeedle >::Type, Value< Container< THaystack >::Type >::Type >::Type) needle[j]) + j/pattern.MACHINE_WORD_SIZE] = pattern.bitMasks[pattern.blockCount * ordValue((CompareType< Value< TNeedle >::Type, Value< Container< THaystack >::Type >::Type >::Type) needle[j]) + j/MACHINE_WORD_SIZE] | ((TWord)1 << (j%MACHINE_WORD_SIZE));
 
+    if (blockCount > 1)
+    {
+        unsigned letterCount = 0;
+        for (unsigned c = 0; c < ValueSize<TValue>::VALUE; ++c)
+        {
+            TWord occurs = 0;
+            for (unsigned block = 0; block < blockCount; ++block)
+                occurs |= pattern.bitMasks[blockCount * c + block];
+            letterCount += occurs != (TWord)0;
+        }
+        pattern.largePattern->letterCount = letterCount;
+    }
+
     _findBeginInit(pattern, needle);
 }
 
@@ -751,6 +766,109 @@ getScore(Pattern<TNeedle, Myers<TSpec, True, TFindBeginPatternSpec> > const & st
 }
 
 
+//____________________________________________________________________________
+// wide words - needles of two to four blocks
+
+// Needles of up to four blocks can keep a whole column in registers: two
+// blocks as one 128-bit word, three or four as two of them. The carries
+// between the blocks are then a fixed sequence of instructions rather than
+// the loop over the blocks of the band.
+#if defined(__SIZEOF_INT128__) && __SIZEOF_LONG__ == 8 && !defined(SEQAN_SSE2_INT128)
+#define SEQAN_MYERS_WIDE 1
+#endif
+
+#ifdef SEQAN_MYERS_WIDE
+typedef unsigned __int128 MyersWord128_;
+
+// 256 bits as two 128-bit halves
+struct MyersWord256_
+{
+    MyersWord128_ lo;
+    MyersWord128_ hi;
+};
+
+inline MyersWord256_ operator & (MyersWord256_ a, MyersWord256_ b) { MyersWord256_ r = {a.lo & b.lo, a.hi & b.hi}; return r; }
+inline MyersWord256_ operator | (MyersWord256_ a, MyersWord256_ b) { MyersWord256_ r = {a.lo | b.lo, a.hi | b.hi}; return r; }
+inline MyersWord256_ operator ^ (MyersWord256_ a, MyersWord256_ b) { MyersWord256_ r = {a.lo ^ b.lo, a.hi ^ b.hi}; return r; }
+inline MyersWord256_ operator ~ (MyersWord256_ a) { MyersWord256_ r = {~a.lo, ~a.hi}; return r; }
+
+inline MyersWord256_ operator + (MyersWord256_ a, MyersWord256_ b)
+{
+    MyersWord256_ r;
+    r.lo = a.lo + b.lo;
+    r.hi = a.hi + b.hi + (MyersWord128_)(r.lo < a.lo);
+    return r;
+}
+
+// (x << 1) | bit
+inline MyersWord128_ _myersShiftIn(MyersWord128_ x, unsigned long bit)
+{
+    return (x << 1) | bit;
+}
+
+inline MyersWord256_ _myersShiftIn(MyersWord256_ x, unsigned long bit)
+{
+    MyersWord256_ r = {(x.lo << 1) | bit, (x.hi << 1) | (x.lo >> 127)};
+    return r;
+}
+
+// the wide word of a column of BLOCKS blocks and its conversion from and to the blocks
+template <unsigned BLOCKS>
+struct MyersWideWord_;
+
+template <>
+struct MyersWideWord_<2>
+{
+    typedef MyersWord128_ Type;
+
+    static Type load(unsigned long const * w) { return ((Type)w[1] << 64) | w[0]; }
+    static void store(unsigned long * w, Type x) { w[0] = (unsigned long)x; w[1] = (unsigned long)(x >> 64); }
+    static unsigned long last(Type x) { return (unsigned long)(x >> 64); }
+};
+
+template <>
+struct MyersWideWord_<3>
+{
+    typedef MyersWord256_ Type;
+
+    static Type load(unsigned long const * w) { Type x = {((MyersWord128_)w[1] << 64) | w[0], w[2]}; return x; }
+    static void store(unsigned long * w, Type x) { MyersWideWord_<2>::store(w, x.lo); w[2] = (unsigned long)x.hi; }
+    static unsigned long last(Type x) { return (unsigned long)x.hi; }
+};
+
+template <>
+struct MyersWideWord_<4>
+{
+    typedef MyersWord256_ Type;
+
+    static Type load(unsigned long const * w) { Type x = {MyersWideWord_<2>::load(w), MyersWideWord_<2>::load(w + 2)}; return x; }
+    static void store(unsigned long * w, Type x) { MyersWideWord_<2>::store(w, x.lo); MyersWideWord_<2>::store(w + 2, x.hi); }
+    static unsigned long last(Type x) { return (unsigned long)(x.hi >> 64); }
+};
+#endif
+
+// The blocks to compute as one wide word, or 0 to compute the band block by
+// block. Banded, a column costs about a block while the last active cell stays
+// in the first one and twice that once it leaves it, which on random text it
+// does from about 16 errors on for 4 letters, 48 for up to 16 and 56 beyond.
+// Two blocks as a wide word cost about one banded block from a handful of
+// errors on, three or four about two.
+inline unsigned
+_myersWideBlocks(unsigned blockCount, unsigned letterCount, unsigned maxErrors)
+{
+#ifdef SEQAN_MYERS_WIDE
+    if (blockCount == 2)
+        return (maxErrors >= 4 || letterCount <= 4) ? 2 : 0;
+    if (blockCount <= 4)
+        return maxErrors >= (letterCount <= 4 ? 16u : letterCount <= 16 ? 48u : 56u) ? blockCount : 0;
+#else
+    (void)blockCount;
+    (void)letterCount;
+    (void)maxErrors;
+#endif
+    return 0;
+}
+
 template <typename TNeedle, typename TSpec, typename THasState, typename TFindBeginPatternSpec, typename TFinder>
 inline bool
 _patternInit(Pattern<TNeedle, Myers<TSpec, THasState, TFindBeginPatternSpec> > const & pattern,
@@ -774,14 +892,25 @@ _patternInit(Pattern<TNeedle, Myers<TSpec, THasState, TFindBeginPatternSpec> > c
             state.largeState = new TLargeState;
 
         TLargeState &largeState = *state.largeState;
-        // localMaxErrors either stores the maximal number of errors (me.maxErrors) or the needle size minus one.
-        // It is used for the mask computation and setting the initial score (the minus one is there because of the Ukkonen trick).
-        int localMaxErrors = _min(state.maxErrors, pattern.needleSize - 1);
-        state.errors = localMaxErrors + 1;
-        largeState.scoreMask = (TWord)1 << (localMaxErrors % pattern.MACHINE_WORD_SIZE);
-        largeState.lastBlock = localMaxErrors / pattern.MACHINE_WORD_SIZE;
-        if (largeState.lastBlock >= pattern.largePattern->blockCount)
+        largeState.wideBlocks = _myersWideBlocks(pattern.largePattern->blockCount, pattern.largePattern->letterCount, state.maxErrors);
+        if (largeState.wideBlocks != 0)
+        {
+            // the whole column is computed, the score is tracked in the last row
+            state.errors = pattern.needleSize;
+            largeState.scoreMask = pattern.largePattern->finalScoreMask;
             largeState.lastBlock = pattern.largePattern->blockCount - 1;
+        }
+        else
+        {
+            // localMaxErrors either stores the maximal number of errors (me.maxErrors) or the needle size minus one.
+            // It is used for the mask computation and setting the initial score (the minus one is there because of the Ukkonen trick).
+            int localMaxErrors = _min(state.maxErrors, pattern.needleSize - 1);
+            state.errors = localMaxErrors + 1;
+            largeState.scoreMask = (TWord)1 << (localMaxErrors % pattern.MACHINE_WORD_SIZE);
+            largeState.lastBlock = localMaxErrors / pattern.MACHINE_WORD_SIZE;
+            if (largeState.lastBlock >= pattern.largePattern->blockCount)
+                largeState.lastBlock = pattern.largePattern->blockCount - 1;
+        }
 
         clear(largeState.VP);
         resize(largeState.VP, pattern.largePattern->blockCount, ~(TWord)0, Exact());
@@ -1216,6 +1345,79 @@ _patternInit(Pattern<TNeedle, Myers<TSpec, True, TFindBeginPatternSpec> > & patt
 //////////////////////////////////////////////////////////////////////////////
 
 
+#ifdef SEQAN_MYERS_WIDE
+// The whole column of a needle of BLOCKS blocks as one wide word, the score is tracked in the last row.
+template <unsigned BLOCKS, typename TFinder, typename TNeedle, typename TSpec, typename THasState, typename THasState2, typename TFindBeginPatternSpec, typename TSize>
+inline bool _findMyersWidePatterns (TFinder & finder,
+                                    Pattern<TNeedle, Myers<TSpec, THasState, TFindBeginPatternSpec> > const & pattern,
+                                    PatternState_<TNeedle, Myers<TSpec, THasState2, TFindBeginPatternSpec> > & state,
+                                    TSize haystack_length)
+{
+    typedef typename Haystack<TFinder>::Type THaystack;
+    typedef typename Iterator<THaystack, Standard>::Type THaystackIterator;
+    typedef MyersLargeState_<TNeedle, TSpec> TLargeState;
+    typedef typename TLargeState::TWord TWord;
+    typedef MyersWideWord_<BLOCKS> TWide;
+    typedef typename TWide::Type TVector;
+
+    TLargeState &largeState = *state.largeState;
+    TWord const finalScoreMask = pattern.largePattern->finalScoreMask;
+    TWord const * bitMasks = begin(pattern.bitMasks, Standard());
+
+    // the columns are walked with a plain iterator, the finder is moved once at the end
+    TSize const startPos = position(finder);
+    TSize pos = startPos;
+    THaystackIterator text = begin(container(finder), Standard()) + pos;
+
+    TVector VP = TWide::load(begin(largeState.VP, Standard()));
+    TVector VN = TWide::load(begin(largeState.VN, Standard()));
+    TVector X, D0, HN, HP;
+    unsigned errors = state.errors;
+    unsigned const maxErrors = state.maxErrors;
+
+    for (; pos < haystack_length; ++pos, ++text)
+    {
+        X = TWide::load(bitMasks + BLOCKS * ordValue((typename Value<TNeedle>::Type) *text)) | VN;
+
+        D0 = ((VP + (X & VP)) ^ VP) | X;
+        HN = VP & D0;
+        HP = VN | ~(VP | D0);
+        X = _myersShiftIn(HP, (int)MyersUkkonenHP0_<TSpec>::VALUE);
+        VN = X & D0;
+        VP = _myersShiftIn(HN, 0) | ~(X | D0);
+
+        if ((TWide::last(HP) & finalScoreMask) != (TWord)0)
+            errors++;
+        else if ((TWide::last(HN) & finalScoreMask) != (TWord)0)
+            errors--;
+
+        if (errors <= maxErrors)
+            break;
+    }
+
+#ifdef FUZZY_SEARCH_STATS
+    TSize columns = pos - startPos + (pos < haystack_length);
+    FUZZY_STATS_ADD(bytes_scanned, columns);
+    FUZZY_STATS_ADD(myers_blocks, columns * BLOCKS);
+#endif
+
+    TWide::store(begin(largeState.VP, Standard()), VP);
+    TWide::store(begin(largeState.VN, Standard()), VN);
+    state.errors = errors;
+    hostIterator(finder) += pos - startPos;
+
+    if (pos == haystack_length)
+        return false;
+
+    _setFinderEnd(finder);
+    if (IsSameType<TSpec, FindPrefix>::VALUE)
+    {
+        _setFinderLength(finder, endPosition(finder));
+    }
+    return true;
+}
+#endif
+
 template <typename TFinder, typename TNeedle, typename TSpec, typename THasState, typename THasState2, typename TFindBeginPatternSpec, typename TSize>
 inline bool _findMyersLargePatterns (TFinder & finder,
                                      Pattern<TNeedle, Myers<TSpec, THasState, TFindBeginPatternSpec> > const & pattern,
@@ -1233,8 +1435,72 @@ inline bool _findMyersLargePatterns (TFinder & finder,
     TLargePattern &largePattern = *pattern.largePattern;
     TLargeState &largeState = *state.largeState;
 
+#ifdef FUZZY_SEARCH_STATS
+    // flushed on return, the blocks of every column are summed up locally
+    unsigned long long columns = 0, blocks = 0;
+    struct StatsFlush
+    {
+        unsigned long long & columns, & blocks;
+        ~StatsFlush() { FUZZY_STATS_ADD(bytes_scanned, columns); FUZZY_STATS_ADD(myers_blocks, blocks); }
+    } statsFlush = {columns, blocks};
+#endif
+
     while (position(finder) < haystack_length)
     {
+        // While the last active cell is in the first block and not its last
+        // cell, no other block is computed. The first block then stays in
+        // registers until the cell reaches the last bit of the block.
+        if (largeState.lastBlock == 0 && (largeState.scoreMask >> (pattern.MACHINE_WORD_SIZE - 1)) == (TWord)0)
+        {
+            TWord VP = largeState.VP[0], VN = largeState.VN[0], scoreMask = largeState.scoreMask;
+            unsigned short errors = state.errors;
+            unsigned short const maxErrors = state.maxErrors;
+            do
+            {
+                shift = largePattern.blockCount * ordValue((typename Value< TNeedle >::Type) *finder);
+                X = pattern.bitMasks[shift] | VN;
+                D0 = (((X & VP) + VP) ^ VP) | X;
+                HN = VP & D0;
+                HP = VN | ~(VP | D0);
+                X = (HP << 1) | (TWord)(int)MyersUkkonenHP0_<TSpec>::VALUE;
+                VN = X & D0;
+                VP = (HN << 1) | ~(X | D0);
+
+                if ((HP & scoreMask) != (TWord)0)
+                    errors++;
+                else if ((HN & scoreMask) != (TWord)0)
+                    errors--;
+
+                // updating the last active cell, no further up than the first row
+                while (errors > maxErrors && scoreMask != (TWord)0)
+                {
+                    if ((VP & scoreMask) != (TWord)0)
+                        errors--;
+                    else if ((VN & scoreMask) != (TWord)0)
+                        errors++;
+                    scoreMask >>= 1;
+                }
+                scoreMask = scoreMask != (TWord)0 ? scoreMask << 1 : (TWord)1;
+                if ((VP & scoreMask) != (TWord)0)
+                    errors++;
+                else if ((VN & scoreMask) != (TWord)0)
+                    errors--;
+
+#ifdef FUZZY_SEARCH_STATS
+                ++columns;
+                ++blocks;
+#endif
+                goNext(finder);
+            }
+            while ((scoreMask >> (pattern.MACHINE_WORD_SIZE - 1)) == (TWord)0 && position(finder) < haystack_length);
+
+            largeState.VP[0] = VP;
+            largeState.VN[0] = VN;
+            largeState.scoreMask = scoreMask;
+            state.errors = errors;
+            continue;
+        }
+
         carryD0 = carryHN = 0;
         carryHP = (int)MyersUkkonenHP0_<TSpec>::VALUE; // FIXME: replace Noting with TSpec
 
@@ -1246,6 +1512,11 @@ inline bool _findMyersLargePatterns (TFinder & finder,
 
         shift = largePattern.blockCount * ordValue((typename Value< TNeedle >::Type) *finder);
 
+#ifdef FUZZY_SEARCH_STATS
+        ++columns;
+        blocks += limit + 1;
+#endif
+
         // computing the necessary blocks, carries between blocks following one another are stored
         for (currentBlock = 0; currentBlock <= limit; currentBlock++)
         {
@@ -1343,9 +1614,22 @@ _findMyersSmallPatterns(
     TWord X, D0, HN, HP;
     TWord lastBit = (TWord)1 << (pattern.needleSize - 1);
 
+#ifdef FUZZY_SEARCH_STATS
+    // flushed on return, one block per column
+    unsigned long long columns = 0;
+    struct StatsFlush
+    {
+        unsigned long long & columns;
+        ~StatsFlush() { FUZZY_STATS_ADD(bytes_scanned, columns); FUZZY_STATS_ADD(myers_blocks, columns); }
+    } statsFlush = {columns};
+#endif
+
     // computing the blocks
     while (position(finder) < haystack_length)
     {
+#ifdef FUZZY_SEARCH_STATS
+        ++columns;
+#endif
         X = pattern.bitMasks[ordValue((typename Value<TNeedle>::Type) *finder)] | state.VN0;
 
         D0 = ((state.VP0 + (X & state.VP0)) ^ state.VP0) | X;
@@ -1612,8 +1896,19 @@ inline bool find (TFinder & finder,
     // distinguish between the version for needles not longer than one machineword and the version for longer needles
     if (pattern.largePattern == NULL)
         return _findMyersSmallPatterns(finder, pattern, state, haystack_length);
-    else
-        return _findMyersLargePatterns(finder, pattern, state, haystack_length);
+
+#ifdef SEQAN_MYERS_WIDE
+    switch (state.largeState->wideBlocks)
+    {
+    case 2:
+        return _findMyersWidePatterns<2>(finder, pattern, state, haystack_length);
+    case 3:
+        return _findMyersWidePatterns<3>(finder, pattern, state, haystack_length);
+    case 4:
+        return _findMyersWidePatterns<4>(finder, pattern, state, haystack_length);
+    }
+#endif
+    return _findMyersLargePatterns(finder, pattern, state, haystack_length);
 }
 
 
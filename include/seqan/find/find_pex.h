@@ -48,8 +48,8 @@ struct NonHierarchical;
 template <typename TVerification, typename TMultiFinder = WuManber>
 struct Pex;
 
-typedef Pex<Hierarchical,AhoCorasick>      PexHierarchical;
-typedef Pex<NonHierarchical,AhoCorasick>   PexNonHierarchical;
+typedef Pex<Hierarchical,AhoCorasickDense>      PexHierarchical;
+typedef Pex<NonHierarchical,AhoCorasickDense>   PexNonHierarchical;
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -112,11 +112,13 @@ struct PexRange_{
  * @tparam TNeedle       The needle type. Type: @link ContainerConcept @endlink
  * @tparam TVerification Determines if the hierarchical verification proposed by Navarro and Beaza-Yates is used or
  *                       not.
- * @tparam TMultiFinder  Specifies the algorithm for the multiple exact string matching algorithm.  Type: AhoCorasick.
+ * @tparam TMultiFinder  Specifies the algorithm for the multiple exact string matching algorithm.  Types: AhoCorasick,
+ *                       AhoCorasickDense.
  *
  * There are two defaults available: <tt>PexHierarchical</tt> and <tt>PexNonHiearchical</tt> (e.g.
- * <tt>Pattern&lt;CharString&gt;, PexHierarchical&gt;</tt> that both use the @link AhoCorasickPattern Aho-Corasick
- * @endlink algorithm for the multiple exact string matching.
+ * <tt>Pattern&lt;CharString&gt;, PexHierarchical&gt;</tt> that both use the @link AhoCorasickDensePattern
+ * Aho-Corasick automaton with a transition table @endlink for the multiple exact string matching, as the needle
+ * only has k + 1 pieces.
  */
 
 /*!
@@ -424,6 +426,7 @@ inline bool find (TFinder & finder, Pattern<TNeedle, Pex<NonHierarchical, TMulti
     THostSegment s(infix(host(finder),start,end));
     THSFinder f(s);
 
+    FUZZY_STATS_ADD(verifications, 1);
     while(find(f,me.range_table[_getRoot(me)].verifier))
     {
       unsigned nP = start + position(f);
@@ -433,6 +436,7 @@ inline bool find (TFinder & finder, Pattern<TNeedle, Pex<NonHierarchical, TMulti
     finder += offset;
     me.findNext = true;
     _setFinderEnd(finder);
+    FUZZY_STATS_ADD(verifications_passed, 1);
     return true;
       }
     }
@@ -454,6 +458,8 @@ inline bool find (TFinder & finder, Pattern<TNeedle, Pex<NonHierarchical, TMulti
 
     THostSegment i(infix(host(mf),s,e));
     THSFinder f(i);
+    FUZZY_STATS_ADD(filter_hits, 1);
+    FUZZY_STATS_ADD(verifications, 1);
     while(find(f,me.range_table[_getRoot(me)].verifier))
     {
       unsigned nP = s + position(f);
@@ -465,6 +471,7 @@ inline bool find (TFinder & finder, Pattern<TNeedle, Pex<NonHierarchical, TMulti
     me.lastFNdl = position(me.multiPattern);
     me.findNext = true;
     _setFinderEnd(finder);
+    FUZZY_STATS_ADD(verifications_passed, 1);
     return true;
       }
     }
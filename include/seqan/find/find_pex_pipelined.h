@@ -0,0 +1,468 @@
+// ==========================================================================
+//                 SeqAn - The Library for Sequence Analysis
+// ==========================================================================
+// Copyright (c) 2006-2016, Knut Reinert, FU Berlin
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of Knut Reinert or the FU Berlin nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL KNUT REINERT OR THE FU BERLIN BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+// OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+// DAMAGE.
+//
+// ==========================================================================
+// Pex with its verification on worker threads.
+// ==========================================================================
+
+#ifndef SEQAN_HEADER_FIND_PEX_PIPELINED_H
+#define SEQAN_HEADER_FIND_PEX_PIPELINED_H
+
+namespace seqan
+{
+
+struct Pipelined;
+
+typedef Pex<Pipelined,AhoCorasickDense>         PexPipelined;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/*!
+ * @class PipelinedPexPattern
+ * @extends PexPattern
+ * @headerfile <seqan/find.h>
+ * @brief Pex whose candidate windows are verified by worker threads while the pieces are still searched.
+ *
+ * @signature template <typename TNeedle, typename TMultiFinder>
+ *            class Pattern<TNeedle, Pex<Pipelined, TMultiFinder> >;
+ *
+ * @tparam TNeedle      The needle type. Type: @link ContainerConcept @endlink
+ * @tparam TMultiFinder Specifies the algorithm for the multiple exact string matching algorithm.
+ *
+ * The needle is split into k + 1 pieces as by @link NonHierarchicalPexPattern @endlink. The haystack is searched
+ * in rounds of @link PipelinedPexPattern#setRoundLength @endlink characters: the calling thread searches a round for
+ * the pieces, merges overlapping candidate windows and hands them to worker threads through a
+ * @link ConcurrentQueue @endlink. The workers verify the windows with Myers' algorithm. Once it has searched the
+ * round, the calling thread verifies windows as well. The occurrences are ordered by end position, with the best
+ * score of each end, and reported by find as soon as no window of a later round can end at or before them; the
+ * others are kept for the next round. So at most about a round of occurrences is buffered.
+ *
+ * The number of threads, the calling one included, is set with @link PipelinedPexPattern#setVerificationThreads
+ * @endlink and defaults to the number of hardware threads. With one thread the windows are verified as they are
+ * found. An exception of a worker thread is rethrown by find once all threads of the round have been joined.
+ */
+
+template <typename TNeedle, typename TMultiFinder>
+class Pattern<TNeedle, Pex<Pipelined, TMultiFinder> >
+{
+//____________________________________________________________________________
+private:
+    Pattern(Pattern const& other);
+    Pattern const& operator=(Pattern const & other);
+
+//____________________________________________________________________________
+public:
+    typedef typename Size<TNeedle>::Type TSize;
+    typedef Segment<TNeedle> TPiece;
+    typedef Pattern<TNeedle, MyersUkkonen> TVerifier;
+    typedef Pattern<String<TPiece>, TMultiFinder> TMFinder;
+    // a candidate window [first, second) of the haystack
+    typedef std::pair<uint64_t, uint64_t> TWindow;
+    // an occurrence by the haystack position of its last character and its errors
+    typedef std::pair<uint64_t, unsigned> TOccurrence;
+
+    // the maximal accepted error
+    unsigned limit;
+    Holder<TNeedle> data_host;
+
+    // pattern object for the multi pattern search and its needles
+    TMFinder multiPattern;
+    String<TPiece> pieces;
+    String<TSize> pieceStart;           // position of each piece in the needle
+
+    // threads searching and verifying, the calling one included, 0 for one per hardware thread
+    unsigned threads;
+    // haystack characters whose pieces are searched per round
+    uint64_t roundLength;
+
+    // the reported occurrences of the rounds searched and the next one, the others
+    // may still be improved by windows of the next round
+    std::vector<TOccurrence> occurrences;
+    std::vector<TOccurrence> pending;
+    size_t nextOccurrence;
+    // the haystack position the next round starts at
+    uint64_t roundStart;
+    bool patternNeedsInit;
+
+    int data_score;
+
+//____________________________________________________________________________
+
+    Pattern() :
+        limit(1), threads(0), roundLength(1 << 22), nextOccurrence(0), roundStart(0), patternNeedsInit(true),
+        data_score(0)
+    {}
+
+    template <typename TNeedle2>
+    Pattern(TNeedle2 && ndl, int _limit = -1) :
+        limit(-_limit), threads(0), roundLength(1 << 22), nextOccurrence(0), roundStart(0), patternNeedsInit(true),
+        data_score(0)
+    {
+        setHost(*this, std::forward<TNeedle2>(ndl));
+    }
+//____________________________________________________________________________
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename TNeedle, typename TMultiFinder>
+void _reinitPattern(Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me)
+{
+    // the pieces depend on the score limit, they are built by _patternInit
+    me.patternNeedsInit = true;
+}
+
+template <typename TNeedle, typename TMultiFinder>
+void _patternInit(Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me)
+{
+    typedef typename Size<TNeedle>::Type TSize;
+
+    TNeedle & ndl = value(me.data_host);
+    TSize const m = length(ndl);
+    unsigned const k = me.limit + 1;
+
+    clear(me.pieces);
+    clear(me.pieceStart);
+    if (m > me.limit)
+    {
+        // split into k pieces of about equal length, as Pex does
+        TSize pos = 0;
+        for (unsigned j = 0; j < k; ++j)
+        {
+            TSize const start = pos;
+            pos = m * (j + 1) / k;
+            appendValue(me.pieces, infix(ndl, start, pos));
+            appendValue(me.pieceStart, start);
+        }
+        setHost(me.multiPattern, me.pieces);
+    }
+    me.patternNeedsInit = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename TNeedle, typename TMultiFinder>
+inline int
+getScore(Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me)
+{
+    return me.data_score;
+}
+
+template <typename TNeedle, typename TMultiFinder>
+inline int
+scoreLimit(Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > const & me)
+{
+    return - (int) me.limit;
+}
+
+template <typename TNeedle, typename TScoreValue, typename TMultiFinder>
+inline void
+setScoreLimit(Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me, TScoreValue _limit)
+{
+    me.patternNeedsInit = true;
+    me.limit = (- _limit);
+}
+
+/*!
+ * @fn PipelinedPexPattern#setVerificationThreads
+ * @headerfile <seqan/find.h>
+ * @brief Sets the number of threads of a search, the calling one included.
+ *
+ * @signature void setVerificationThreads(pattern, threads);
+ *
+ * @param[in,out] pattern The pattern to set the number of threads for.
+ * @param[in]     threads The number of threads, 0 for one per hardware thread.
+ */
+template <typename TNeedle, typename TMultiFinder>
+inline void
+setVerificationThreads(Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me, unsigned threads)
+{
+    me.threads = threads;
+}
+
+/*!
+ * @fn PipelinedPexPattern#setRoundLength
+ * @headerfile <seqan/find.h>
+ * @brief Sets the number of haystack characters searched per round, which bounds the occurrences buffered.
+ *
+ * @signature void setRoundLength(pattern, length);
+ *
+ * @param[in,out] pattern The pattern to set the round length for.
+ * @param[in]     length  The number of characters, at least 1. Defaults to 4M.
+ */
+template <typename TNeedle, typename TMultiFinder>
+inline void
+setRoundLength(Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me, uint64_t length)
+{
+    me.roundLength = std::max<uint64_t>(length, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// The worker threads of a round, joined when it leaves scope, after the queue has been unlocked
+// so that they finish. The exception of a worker is kept until it is rethrown by the calling thread.
+template <typename TQueue>
+struct PexWorkers_
+{
+    TQueue & queue;
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors;
+    bool writing;
+
+    explicit PexWorkers_(TQueue & _queue) : queue(_queue), writing(false)
+    {}
+
+    ~PexWorkers_()
+    {
+        join();
+    }
+
+    void join()
+    {
+        if (writing)
+        {
+            unlockWriting(queue);
+            writing = false;
+        }
+        for (unsigned i = 0; i < threads.size(); ++i)
+            if (threads[i].joinable())
+                threads[i].join();
+    }
+};
+
+// Appends the occurrences in a candidate window to occurrences, returns whether there are any.
+template <typename THaystack, typename TVerifier, typename TWindow, typename TOccurrences>
+inline bool
+_verifyPexWindow(THaystack & haystack, TVerifier & verifier, TWindow const & window, TOccurrences & occurrences)
+{
+    typedef Segment<THaystack> THaystackSegment;
+    typedef Finder<THaystackSegment> TSegmentFinder;
+
+    THaystackSegment segment(infix(haystack, window.first, window.second));
+    TSegmentFinder f(segment);
+    bool found = false;
+    while (find(f, verifier))
+    {
+        occurrences.push_back(std::make_pair(window.first + position(f),
+                                             static_cast<unsigned>(- getScore(verifier))));
+        found = true;
+    }
+    return found;
+}
+
+// The worker threads take the windows from the queue until it is empty and has no writer.
+template <typename THaystack, typename TNeedle, typename TMultiFinder, typename TQueue, typename TOccurrences>
+inline void
+_verifyPexWindows(THaystack & haystack,
+                  Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me,
+                  TQueue & queue,
+                  TOccurrences & occurrences,
+                  unsigned & passed)
+{
+    typedef Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > TPattern;
+    typename TPattern::TVerifier verifier;
+    setHost(verifier, value(me.data_host));
+    setScoreLimit(verifier, - static_cast<int>(me.limit));
+
+    typename TPattern::TWindow window;
+    while (popFront(window, queue))
+        passed += _verifyPexWindow(haystack, verifier, window, occurrences);
+}
+
+// Searches the next round of the haystack for the pieces and verifies their windows. The occurrences
+// that no later window can end at or before are moved to me.occurrences, the others to me.pending.
+template <typename TFinder, typename TNeedle, typename TMultiFinder>
+inline void
+_findPexPipelined(TFinder & finder, Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me)
+{
+    typedef Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > TPattern;
+    typedef typename TPattern::TWindow TWindow;
+    typedef typename TPattern::TOccurrence TOccurrence;
+    typedef typename Host<TFinder>::Type THaystack;
+    typedef Segment<THaystack> THaystackSegment;
+    typedef Finder<THaystackSegment> TSegmentFinder;
+
+    // overlapping windows are merged up to this length, a window of more
+    // does not spread the verification over the threads
+    uint64_t const mergeLength = 1 << 16;
+
+    THaystack & haystack = host(finder);
+    uint64_t const n = length(haystack);
+    uint64_t const m = length(value(me.data_host));
+    unsigned threads = me.threads != 0 ? me.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    // the round takes the hits that start in [roundStart, roundEnd), the pieces
+    // are searched far enough beyond it to find those ending after it
+    uint64_t const roundStart = me.roundStart;
+    uint64_t const roundEnd = std::min(n, roundStart + me.roundLength);
+    uint64_t windowOffset = 0, pieceLength = 0;
+    for (unsigned i = 0; i < length(me.pieces); ++i)
+    {
+        windowOffset = std::max<uint64_t>(windowOffset, me.pieceStart[i] + me.limit);
+        pieceLength = std::max<uint64_t>(pieceLength, length(me.pieces[i]));
+    }
+
+    // one list of occurrences per thread, the calling one is the last
+    std::vector<std::vector<TOccurrence> > occurrences(threads);
+    std::vector<unsigned> passed(threads, 0);
+    ConcurrentQueue<TWindow> queue;
+    PexWorkers_<ConcurrentQueue<TWindow> > workers(queue);
+    typename TPattern::TVerifier verifier;
+    setHost(verifier, value(me.data_host));
+    setScoreLimit(verifier, - static_cast<int>(me.limit));
+
+    if (threads > 1)
+    {
+        lockWriting(queue);
+        workers.writing = true;
+        workers.errors.resize(threads - 1);
+        for (unsigned i = 0; i + 1 < threads; ++i)
+            workers.threads.push_back(std::thread([&, i]() {
+                try
+                {
+                    _verifyPexWindows(haystack, me, queue, occurrences[i], passed[i]);
+                }
+                catch (...)
+                {
+                    workers.errors[i] = std::current_exception();
+                }
+            }));
+    }
+
+    THaystackSegment segment(infix(haystack, roundStart, std::min(n, roundEnd + pieceLength - 1)));
+    TSegmentFinder mf(segment);
+    TWindow merged(0, 0);
+    unsigned windows = 0;
+    while (true)
+    {
+        bool const hit = find(mf, me.multiPattern) && roundStart + position(mf) < roundEnd;
+        TWindow window(0, 0);
+        if (hit)
+        {
+            FUZZY_STATS_ADD(filter_hits, 1);
+            uint64_t const hitStart = roundStart + position(mf);
+            uint64_t const offset = me.pieceStart[position(me.multiPattern)] + me.limit;
+            window.first = hitStart > offset ? hitStart - offset : 0;
+            window.second = std::min<uint64_t>(hitStart + m - me.pieceStart[position(me.multiPattern)] + me.limit, n);
+            if (merged.first < merged.second && window.first <= merged.second && merged.first <= window.second &&
+                std::max(merged.second, window.second) - std::min(merged.first, window.first) <= mergeLength)
+            {
+                merged.first = std::min(merged.first, window.first);
+                merged.second = std::max(merged.second, window.second);
+                continue;
+            }
+        }
+
+        // hand on the merged window, the next one starts with this hit
+        if (merged.first < merged.second)
+        {
+            ++windows;
+            if (threads > 1)
+                appendValue(queue, merged, Generous(), Serial());
+            else
+                passed.back() += _verifyPexWindow(haystack, verifier, merged, occurrences.back());
+        }
+        merged = window;
+        if (!hit)
+            break;
+    }
+    FUZZY_STATS_ADD(verifications, windows);
+
+    if (threads > 1)
+    {
+        // help the workers with the windows left
+        unlockWriting(queue);
+        workers.writing = false;
+        TWindow window;
+        while (popFront(window, queue))
+            passed.back() += _verifyPexWindow(haystack, verifier, window, occurrences.back());
+        workers.join();
+        for (unsigned i = 0; i < workers.errors.size(); ++i)
+            if (workers.errors[i])
+                std::rethrow_exception(workers.errors[i]);
+    }
+
+    // the windows overlap, each end is reported once with its best score
+    std::vector<TOccurrence> & merging = me.pending;
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        merging.insert(merging.end(), occurrences[i].begin(), occurrences[i].end());
+        FUZZY_STATS_ADD(verifications_passed, passed[i]);
+    }
+    std::sort(merging.begin(), merging.end());
+    merging.erase(std::unique(merging.begin(), merging.end(),
+                              [](TOccurrence const & a, TOccurrence const & b) { return a.first == b.first; }),
+                  merging.end());
+
+    // the windows of later rounds start at or after roundEnd - windowOffset
+    uint64_t const released = roundEnd == n ? merging.size() :
+        std::lower_bound(merging.begin(), merging.end(),
+                         TOccurrence(roundEnd > windowOffset ? roundEnd - windowOffset : 0, 0)) - merging.begin();
+    me.occurrences.assign(merging.begin(), merging.begin() + released);
+    merging.erase(merging.begin(), merging.begin() + released);
+    me.nextOccurrence = 0;
+    me.roundStart = roundEnd;
+}
+
+template <typename TFinder, typename TNeedle, typename TMultiFinder>
+inline bool find(TFinder & finder, Pattern<TNeedle, Pex<Pipelined, TMultiFinder> > & me)
+{
+    if (empty(finder))
+    {
+        _finderSetNonEmpty(finder);
+        me.occurrences.clear();
+        me.pending.clear();
+        me.nextOccurrence = 0;
+        me.roundStart = 0;
+    }
+    if (me.patternNeedsInit)
+        _patternInit(me);
+    if (empty(me.pieces))
+        me.roundStart = length(host(finder));
+    while (me.nextOccurrence == me.occurrences.size() && me.roundStart < length(host(finder)))
+        _findPexPipelined(finder, me);
+
+    if (me.nextOccurrence < me.occurrences.size())
+    {
+        me.data_score = - static_cast<int>(me.occurrences[me.nextOccurrence].second);
+        setPosition(finder, me.occurrences[me.nextOccurrence].first);
+        ++me.nextOccurrence;
+        _setFinderEnd(finder);
+        return true;
+    }
+
+    // set finder to end position
+    setPosition(finder, length(host(finder)));
+    return false;
+}
+
+}// namespace seqan
+
+#endif //#ifndef SEQAN_HEADER_FIND_PEX_PIPELINED_H
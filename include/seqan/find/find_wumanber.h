@@ -78,6 +78,7 @@ public:
     //preprocessed data: these members are initialized in setHost
     Holder<TNeedle> data_host;
     String<TNeedlePosition> verify_tab; //table of keywords to verify depending on the last value (HASH)
+    String<unsigned short> prefix_tab; //hash of the first q values of the keyword at the same place in verify_tab (PREFIX)
     String<TNeedlePosition *> verify; //directory into verify_tab
     String<TSize> shift; //table of skip widths (SHIFT)
 
@@ -174,6 +175,7 @@ struct WuManberImpl_
 
         //resize and init tables
         resize(me.verify_tab, (unsigned) k);
+        resize(me.prefix_tab, (unsigned) k);
         resize(me.verify, (unsigned) DIR_SIZE+1);
         resize(me.shift, (unsigned) DIR_SIZE);
 
@@ -218,11 +220,12 @@ struct WuManberImpl_
         {
             if (empty(*pit))
                 continue;  // Skip empty needles.
-            unsigned short hash_plus_1;
+            unsigned int hash_plus_1;
             hash_plus_1 = WuManberHash_<TNeedle, Q>::hash(begin(*pit) + me.lmin-Q) + 1;
 
-            //write into verify_tab
+            //write into verify_tab and prefix_tab
             *(me.verify[hash_plus_1]) = i;
+            me.prefix_tab[me.verify[hash_plus_1] - begin(me.verify_tab)] = WuManberHash_<TNeedle, Q>::hash(begin(*pit));
 
             //update verify
             ++me.verify[hash_plus_1];
@@ -272,9 +275,16 @@ struct WuManberImpl_
                 me.to_verify_end = me.verify[hash+1];
 //VERIFY
 VERIFY:
+                //keywords that begin with other values than the window are passed over without being read
+                unsigned short const prefix = WuManberHash_<TNeedle, Q>::hash(tit - (me.lmin-Q));
                 while (me.to_verify_begin != me.to_verify_end)
                 {
                     me.position = *me.to_verify_begin;
+                    if (me.prefix_tab[me.to_verify_begin - begin(me.verify_tab, Standard())] != prefix)
+                    {
+                        ++me.to_verify_begin;
+                        continue;
+                    }
                     ++me.to_verify_begin;
 
                     TKeyword & kw = needle(me)[me.position];
@@ -348,6 +358,34 @@ struct WuManberHash_<TNeedle, 3>
     }
 };
 
+template <typename TNeedle>
+struct WuManberHash_<TNeedle, 4>
+{
+    typedef typename Value<typename Value<TNeedle>::Type>::Type TValue;
+
+    enum
+    {
+        C = BitsPerValue<TValue>::VALUE,
+        W = WuManberImpl_<TNeedle, 4>::W
+    };
+
+    //the four values side by side, if they do not fit into W bits multiplied and the top W bits kept
+    template <typename TIterator>
+    inline static unsigned short
+    hash(TIterator vals)
+    {
+        uint64_t packed = (uint64_t)ordValue(*vals)
+                        | ((uint64_t)ordValue(*(vals+1)) << C)
+                        | ((uint64_t)ordValue(*(vals+2)) << (2*C))
+                        | ((uint64_t)ordValue(*(vals+3)) << (3*C));
+        if (4*C <= W)
+            return (unsigned short)packed;
+        if (4*C <= 32)
+            return (unsigned short)((uint32_t)((uint32_t)packed * 0x9E3779B1u) >> (32 - W));
+        return (unsigned short)((packed * 0x9E3779B97F4A7C15ull) >> (64 - W));
+    }
+};
+
 //////////////////////////////////////////////////////////////////////////////
 
 template <typename TNeedle>
@@ -380,11 +418,18 @@ void _reinitPattern(Pattern<TNeedle, WuManber> & me)
         //m = lmin
         //k = length(needle)
         //our heuristic: take B = 2 if C^2 >= mk, else B = 3
+        //values of more than 5 bits do not fit three into a hash value, so B = 4
+        //discriminates better once the keywords are long enough to still shift
+        //(m >= 8) and many enough to fill the table (mk >= 1536)
 
         if (C * C >= me.lmin * length(needle(me)))
         {
             me.q = 2;
         }
+        else if (C > 5 && me.lmin >= 8 && me.lmin * length(needle(me)) >= 1536)
+        {
+            me.q = 4;
+        }
         else
         {
             me.q = 3;
@@ -396,7 +441,8 @@ void _reinitPattern(Pattern<TNeedle, WuManber> & me)
     }
 
     //rest of preprocessing is done in WuManberImpl_
-    if (me.q == 2) WuManberImpl_<TNeedle, 2>::initialize(me);
+    if (me.q == 4) WuManberImpl_<TNeedle, 4>::initialize(me);
+    else if (me.q == 2) WuManberImpl_<TNeedle, 2>::initialize(me);
     else if (me.q == 3) WuManberImpl_<TNeedle, 3>::initialize(me);
     else WuManberImpl_<TNeedle, 1>::initialize(me);
 }
@@ -429,7 +475,8 @@ inline bool find(TFinder & finder,
 
     if (me.lmin == 0) return false;
 
-    if (me.q == 2) return WuManberImpl_<TNeedle, 2>::find(finder, me);
+    if (me.q == 4) return WuManberImpl_<TNeedle, 4>::find(finder, me);
+    else if (me.q == 2) return WuManberImpl_<TNeedle, 2>::find(finder, me);
     else if (me.q == 3) return WuManberImpl_<TNeedle, 3>::find(finder, me);
     else return WuManberImpl_<TNeedle, 1>::find(finder, me);
 }
@@ -17,88 +17,254 @@
 **/
 
 #include "libflasm.h"
+#include "libflasm_simd.h"
+
+#if defined ( __SSE2__ )
+#define FLASM_SIMD
+#endif
 
 using namespace libflasm;
 
+// a buffer of a single search, taken from fuzzy::query_resource () within an ArenaScope
+template <typename T>
+using ScratchBuffer = std::vector<T, fuzzy::ResourceAllocator<T> >;
+
+// the order of ResultTuple as a comparator without members, for the top-k heap
+struct ResultOrder
+{
+	bool operator() ( const ResultTuple & a, const ResultTuple & b ) const
+	{
+		return ResultTuple () ( a, b );
+	}
+};
 
 /**
- * This is the libFLASM edit distance function.
+ * Collects the matches reported by the FLASM kernels. Depending on its mode it
+ * keeps the first best match, all matches or the top_k best matches. In top-k
+ * mode the matches live in a fixed-size max-heap ordered by ResultTuple and,
+ * once the heap is full, the error of its worst entry becomes the threshold
+ * the kernels use to prune the search.
  *
- * @param t The text (haystack) to search in
- * @param n The length of t
- * @param x The pattern which has factors that may be present in t
- * @param m The length of x
- * @param factor_length The length of a factor (needle)
- * @param max_error The maximum distance between the factor and a position in t to report
- * @param return_all Return all matches or just the first best one
- * @return The discovered positions are returned in a set that can be iterated over
+ * With a memory budget every match kept in ALL mode is charged to it until
+ * finish () hands the matches over. Once they no longer fit, the remaining
+ * matches are dropped and finish () throws fuzzy::BudgetExceeded, so that the
+ * kernels never see the exception and release their buffers as usual.
  */
-ResultTupleSet libflasm::flasm_ed ( unsigned char * t, unsigned int n, unsigned char * x, unsigned int m, unsigned int factor_length, unsigned int max_error, bool return_all )
+class ResultCollector
 {
-	unsigned char * h;
-	h = ( unsigned char * ) calloc ( factor_length + 1, sizeof ( unsigned char ) );
+public:
+	enum Mode { BEST, ALL, TOP_K };
 
-	int k = -max_error;
-	unsigned int error = 0;
-	unsigned int pos_t = 0;
-	unsigned int pos_x = 0;
+	ResultCollector ( Mode mode, unsigned int max_error, size_t m, unsigned int top_k = 0, fuzzy::MemoryBudget * budget = NULL ) :
+		mode ( mode ), max_error ( max_error ), top_k ( top_k ), budget ( budget ), charged ( 0 ), exceeded ( false )
+	{
+		//no match can have m errors, so it marks that no best match was found
+		unset = m < UINT_MAX ? (unsigned int) m : UINT_MAX;
+
+		best.pos_t = 0;
+		best.pos_x = 0;
+		best.error = unset;
+
+		if ( mode == TOP_K )
+		{
+			heap.reserve ( top_k );
+		}
+	}
+
+	// largest error a match may have to still be collected
+	unsigned int threshold () const
+	{
+		if ( mode == TOP_K && heap.size () == top_k && heap.front ().error < max_error )
+		{
+			return heap.front ().error;
+		}
+		return max_error;
+	}
+
+	void add ( size_t pos_t, size_t pos_x, unsigned int error )
+	{
+		ResultTuple match = {pos_t, pos_x, error};
+
+		switch ( mode )
+		{
+		    case ALL:
+			if ( budget != NULL )
+			{
+				if ( exceeded || !budget->fits ( RESULT_NODE_SIZE ) )
+				{
+					exceeded = true;
+					break;
+				}
+				budget->charge ( RESULT_NODE_SIZE );
+				charged += RESULT_NODE_SIZE;
+			}
+			results.insert ( match );
+			break;
+
+		    case BEST:
+			//ties go to the match the sequential scan meets first, so that
+			//the result does not depend on the order matches are added in
+			if ( error < best.error || ( error == best.error && ( pos_x < best.pos_x || ( pos_x == best.pos_x && pos_t < best.pos_t ) ) ) )
+			{
+				best = match;
+			}
+			break;
 
-	ResultTuple best = {0, 0, m};
+		    case TOP_K:
+			if ( heap.size () < top_k )
+			{
+				heap.push_back ( match );
+				std::push_heap ( heap.begin (), heap.end (), order );
+			}
+			else if ( order ( match, heap.front () ) )
+			{
+				//replace the worst match kept so far
+				std::pop_heap ( heap.begin (), heap.end (), order );
+				heap.back () = match;
+				std::push_heap ( heap.begin (), heap.end (), order );
+			}
+			break;
+		}
+	}
 
+	ResultTupleSet finish ()
+	{
+		if ( budget != NULL )
+		{
+			budget->release ( charged );
+			charged = 0;
+			if ( exceeded )
+			{
+				results.clear ();
+				throw fuzzy::BudgetExceeded ();
+			}
+		}
+
+		if ( mode == BEST && best.error != unset )
+		{
+			results.insert ( best );
+		}
+		else if ( mode == TOP_K )
+		{
+			results.insert ( heap.begin (), heap.end () );
+			heap.clear ();
+		}
+		return std::move ( results );
+	}
+
+private:
+	//bytes of a node of ResultTupleSet, charged per match kept
+	static const size_t RESULT_NODE_SIZE = sizeof ( ResultTuple ) + 4 * sizeof ( void * );
+
+	Mode mode;
+	unsigned int max_error;
+	unsigned int unset;
+	unsigned int top_k;
+	ResultOrder order;
+	ResultTuple best;
+	std::vector<ResultTuple> heap;
 	ResultTupleSet results;
+	fuzzy::MemoryBudget * budget;
+	size_t charged;
+	bool exceeded;
+};
+
 
-	CharString haystack = (CharString) t;
+/**
+ * Runs the FLASM edit distance search, passing every match found to collector.
+ * The Myers search of each factor is limited to the current collector threshold
+ * so that a filling top-k heap prunes the remaining factors.
+ */
+static ResultTupleSet flasm_ed_scan ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, ResultCollector & collector )
+{
+	//x has no factors to search, and the loop bound below would wrap around
+	if ( factor_length == 0 || m < factor_length )
+	{
+		return collector.finish ();
+	}
+
+	unsigned int error = 0;
+	size_t pos_t = 0;
+	size_t pos_x = 0;
+
+	//wrap t without copying it, so memory-mapped texts of any size can be searched
+	TextView haystack ( ( char * ) t, ( char * ) t + n );
 	CharString needle;
-	Finder<CharString> finder( haystack );
+	Finder<TextView> finder( haystack );
 	Pattern<CharString, Myers<>> pattern;
 
-	unsigned int i;
+	size_t i;
 	for ( i = 0; i < m - factor_length + 1; i++ )
 	{
-		memcpy( &h[0], &x[i], factor_length );
-		h[factor_length] = '\0';
-
-		needle = (CharString) h;
+		//copy the factor by length, it may contain '\0'
+		assign( needle, TextView ( ( char * ) &x[i], ( char * ) &x[i] + factor_length ) );
 
 		setNeedle( pattern, needle );
 
-		while ( find( finder, pattern, k ) )
+		while ( find( finder, pattern, -(int) collector.threshold () ) )
 		{
-			pos_t = (unsigned int) endPosition( finder ) - 1;
+			pos_t = (size_t) endPosition( finder ) - 1;
 
 			pos_x = i + factor_length - 1;
 
 			error = (unsigned int) abs( getScore( pattern ) );
 
-			if ( return_all )
-			{
-				ResultTuple match = {pos_t, pos_x, error};
-
-				results.insert( match );
-			}
-			else if ( error < best.error )
-			{
-				best.pos_t = pos_t;
-
-				best.pos_x = pos_x;
-
-				best.error = error;
-			}
+			collector.add ( pos_t, pos_x, error );
 		}
 
 		clear( finder );
 
 		goBegin( finder );
+
+		FUZZY_STATS_ADD ( cells, (unsigned long long) n * factor_length );
 	}
 
-	free ( h );
+	return collector.finish ();
+}
 
-	if ( !return_all && best.error != m )
+/**
+ * This is the libFLASM edit distance function.
+ *
+ * @param t The text (haystack) to search in
+ * @param n The length of t
+ * @param x The pattern which has factors that may be present in t
+ * @param m The length of x
+ * @param factor_length The length of a factor (needle)
+ * @param max_error The maximum distance between the factor and a position in t to report
+ * @param return_all Return all matches or just the first best one
+ * @return The discovered positions are returned in a set that can be iterated over
+ */
+ResultTupleSet libflasm::flasm_ed ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, bool return_all )
+{
+	ResultCollector collector ( return_all ? ResultCollector::ALL : ResultCollector::BEST, max_error, m );
+
+	return flasm_ed_scan ( t, n, x, m, factor_length, collector );
+}
+
+/**
+ * This is the libFLASM edit distance function in top-k mode. The top_k best
+ * results are taken over all (pos_t, pos_x) pairs of the text, not per factor,
+ * so a factor with many good matches can take every place.
+ *
+ * @param t The text (haystack) to search in
+ * @param n The length of t
+ * @param x The pattern which has factors that may be present in t
+ * @param m The length of x
+ * @param factor_length The length of a factor (needle)
+ * @param max_error The maximum distance between the factor and a position in t to report
+ * @param top_k The number of best matches to return
+ * @return The top_k best (pos_t, pos_x) pairs, ordered as ResultTuple, in a set that can be iterated over
+ */
+ResultTupleSet libflasm::flasm_ed_topk ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, unsigned int top_k )
+{
+	if ( top_k == 0 )
 	{
-		results.insert( best );
+		return ResultTupleSet ();
 	}
 
-	return results;
+	ResultCollector collector ( ResultCollector::TOP_K, max_error, m, top_k );
+
+	return flasm_ed_scan ( t, n, x, m, factor_length, collector );
 }
 
 /**
@@ -181,61 +347,37 @@ inline WORD * shiftc_words ( WORD * words, struct libflasm::Limit lim )
 
 
 /**
- * This is the libFLASM Hamming distance function.
- *
- * @param t The text (haystack) to search in
- * @param n The length of t
- * @param x The pattern which has factors that may be present in t
- * @param m The length of x
- * @param factor_length The length of a factor (needle)
- * @param max_error The maximum distance between the factor and a position in t to report
- * @param return_all Return all matches or just the first best one
- * @return The discovered positions are returned in a set that can be iterated over
+ * Runs the FLASM Hamming distance search, passing every match found to
+ * collector. Cells are only reported while their error is within the current
+ * collector threshold.
  */
-ResultTupleSet libflasm::flasm_hd ( unsigned char * t, unsigned int n, unsigned char * x, unsigned int m, unsigned int factor_length, unsigned int max_error, bool return_all )
+static ResultTupleSet flasm_hd_scan ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, ResultCollector & collector )
 {
-	ResultTupleSet results;
-
-	unsigned int i, j, k, err;
+	fuzzy::ArenaScope scope;
+	fuzzy::ResourceAllocator<WORD> allocator ( fuzzy::query_resource () );
 
-	ResultTuple best = {0, 0, m};
+	size_t i, j;
+	unsigned int k, err;
 
 	libflasm::Limit lim;
 	lim = init_limit ( factor_length, lim );
-	WORD * ones;
-	if ( ( ones = ( WORD * ) calloc ( lim.words , sizeof ( WORD ) ) ) == NULL )
-	{
-	       	fprintf( stderr, " Error: ow could not be allocated!\n");
-	       	return results;
-	}
-											    
-	//initialise 2 line matrix
-	WORD ** M0;
-	WORD ** M1;
-	if ( ( M0 = ( WORD ** ) calloc ( ( n + 1 ) , sizeof ( WORD * ) ) ) == NULL )
-	{
-		fprintf( stderr, " Error: M0 could not be allocated!\n");
-		return results;
-	}
-	if ( ( M1 = ( WORD ** ) calloc ( ( n + 1 ) , sizeof ( WORD * ) ) ) == NULL )
-	{
-	       	fprintf( stderr, " Error: M1 could not be allocated!\n");
-	      	return results;
-	}
+	ScratchBuffer<WORD> ones_buffer ( lim.words, 0, allocator );
+	WORD * ones = ones_buffer.data ();
+
+	//initialise 2 line matrix, its rows are cut from one zeroed block
+	ScratchBuffer<WORD> lines ( 2 * ( n + 1 ) * lim.words, 0, allocator );
+	ScratchBuffer<WORD *> rows ( 2 * ( n + 1 ), NULL, allocator );
+	WORD ** M0 = &rows[0];
+	WORD ** M1 = &rows[n + 1];
 	for ( j = 0; j < n + 1; j ++ )
 	{
-	   	if ( ( M0[j] = ( WORD * ) calloc ( lim.words , sizeof ( WORD ) ) ) == NULL )
-	   	{
-			fprintf( stderr, " Error: M0J could not be allocated!\n");
-			return results;
-	  	}
-	       	if ( ( M1[j] = ( WORD * ) calloc ( lim.words , sizeof ( WORD ) ) ) == NULL )
-		{
-	            	fprintf( stderr, " Error: M1J could not be allocated!\n");
-	            	return results;
-	        }
+		M0[j] = lines.data () + j * lim.words;
+		M1[j] = lines.data () + ( n + 1 + j ) * lim.words;
 	}
 
+	FUZZY_STATS_ADD ( bytes_scanned, n );
+	FUZZY_STATS_ADD ( cells, (unsigned long long) n * m );
+
 	//loop through sequences
         for ( i = 1; i < m + 1; i++ ) //loop through x
         {
@@ -276,22 +418,9 @@ ResultTupleSet libflasm::flasm_hd ( unsigned char * t, unsigned int n, unsigned
 				{                
 					err = popcount_words ( M1[j], lim.words );
 
-					if ( err <= max_error )
+					if ( err <= collector.threshold () )
 					{
-						if ( return_all )
-						{
-							ResultTuple match = { j - 1, i - 1, err };
-
-							results.insert ( match );
-						}
-						else if ( err < best.error )
-						{
-							best.pos_t = j - 1;
-
-							best.pos_x = i - 1;
-
-							best.error = err;
-						}
+						collector.add ( j - 1, i - 1, err );
 					}
 
 				}
@@ -323,42 +452,737 @@ ResultTupleSet libflasm::flasm_hd ( unsigned char * t, unsigned int n, unsigned
 				{                
 					err = popcount_words ( M0[j], lim.words );
 
-					if ( err <= max_error )
+					if ( err <= collector.threshold () )
 					{
-						if ( return_all )
-						{
-							ResultTuple match = { j - 1, i - 1, err };
+						collector.add ( j - 1, i - 1, err );
+					}
+				}
+				break;
+			}
+		}
+	}
 
-							results.insert ( match );
-						}
-						else if ( err < best.error )
-						{
-							best.pos_t = j - 1;
+	return collector.finish ();
+}
+
+/**
+ * Runs the FLASM Hamming distance search along the diagonals of the (x, t)
+ * matrix instead of building error arrays. Each diagonal keeps the positions of
+ * its last max_error + 1 mismatches in a ring, so a cell whose factor window
+ * holds too many mismatches is rejected after one character comparison and the
+ * errors are only counted for candidate cells. Meant for small max_error, where
+ * the cost approaches one byte comparison per cell.
+ */
+static ResultTupleSet flasm_hd_scan_diagonals ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, ResultCollector & collector )
+{
+	if ( factor_length == 0 || m < factor_length || n < factor_length )
+	{
+		return collector.finish ();
+	}
+
+	FUZZY_STATS_ADD ( bytes_scanned, n );
+
+	fuzzy::ArenaScope scope;
+	size_t ring_size = std::min ( (size_t) collector.threshold (), factor_length ) + 1;
+	ScratchBuffer<size_t> ring ( ring_size, 0, fuzzy::ResourceAllocator<size_t> ( fuzzy::query_resource () ) );
+
+	size_t d, s;
+	for ( d = 0; d < m + n - 2 * factor_length + 1; d++ )
+	{
+		//diagonals start at x[m - h .. 1] against t[0], then at x[0] against t[0 .. n - h]
+		size_t xs = d < m - factor_length ? m - factor_length - d : 0;
+		size_t ts = d < m - factor_length ? 0 : d - ( m - factor_length );
+		size_t length = std::min ( m - xs, n - ts );
+		FUZZY_STATS_ADD ( cells, length );
+
+		size_t head = 0;
+		size_t count = 0;
+
+		for ( s = 0; s < length; s++ )
+		{
+			if ( x[xs + s] != t[ts + s] )
+			{
+				ring[head] = s;
+				head = head + 1 == ring_size ? 0 : head + 1;
+				count = std::min ( count + 1, ring_size );
+			}
+
+			if ( s + 1 < factor_length )
+			{
+				continue;
+			}
+
+			size_t window = s + 1 - factor_length;
+
+			//when full, head is the oldest of ring_size mismatches
+			if ( count == ring_size && ring[head] >= window )
+			{
+				continue;
+			}
+
+			unsigned int err = 0;
+			size_t r = head;
+			while ( err < count )
+			{
+				r = r == 0 ? ring_size - 1 : r - 1;
+				if ( ring[r] < window )
+				{
+					break;
+				}
+				err++;
+			}
+
+			if ( err <= collector.threshold () )
+			{
+				collector.add ( ts + s, xs + s, err );
+			}
+		}
+	}
+
+	return collector.finish ();
+}
+
+unsigned int libflasm::collector_threshold ( const ResultCollector & collector )
+{
+	return collector.threshold ();
+}
+
+void libflasm::collector_add ( ResultCollector & collector, size_t pos_t, size_t pos_x, unsigned int error )
+{
+	collector.add ( pos_t, pos_x, error );
+}
+
+#ifdef FLASM_SIMD
+
+struct CountersKernel
+{
+	const char * name;
+	CountersBlock block;
+};
+
+/**
+ * Picks the diagonal counter kernel for the widest instruction set the CPU
+ * supports. The LIBFLASM_SIMD environment variable (sse2, avx2 or avx512)
+ * caps the choice, e.g. to compare the kernels on one machine.
+ */
+static CountersKernel select_counters_kernel ()
+{
+	const char * cap = getenv ( "LIBFLASM_SIMD" );
+	bool avx512 = cap == NULL || *cap == '\0' || strcmp ( cap, "avx512" ) == 0;
+	bool avx2 = avx512 || strcmp ( cap, "avx2" ) == 0;
+
+#ifdef FLASM_DISPATCH
+	__builtin_cpu_init ();
+	if ( avx512 && __builtin_cpu_supports ( "avx512bw" ) )
+	{
+		CountersKernel kernel = {"avx512", counters_block_avx512};
+		return kernel;
+	}
+	if ( avx2 && __builtin_cpu_supports ( "avx2" ) )
+	{
+		CountersKernel kernel = {"avx2", counters_block_avx2};
+		return kernel;
+	}
+#else
+	( void ) avx2;
+#endif
+
+	CountersKernel kernel = {"sse2", counters_block_sse2};
+	return kernel;
+}
+
+// selected on first use
+static const CountersKernel & counters_kernel ()
+{
+	static const CountersKernel kernel = select_counters_kernel ();
+	return kernel;
+}
+
+#endif
+
+/**
+ * Returns the instruction set of the SIMD Hamming distance kernel in use
+ */
+const char * libflasm::flasm_simd_kernel ()
+{
+#ifdef FLASM_SIMD
+	return counters_kernel ().name;
+#else
+	return "none";
+#endif
+}
+
+#ifdef FLASM_SIMD
+
+/**
+ * Runs the FLASM Hamming distance search with the SIMD diagonal counters. The
+ * text is processed in blocks of BATCH_BLOCK_SIZE columns so that the line of
+ * counters stays cache-resident. Needs factor_length <= UCHAR_MAX.
+ */
+static ResultTupleSet flasm_hd_scan_counters ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, ResultCollector & collector )
+{
+	if ( factor_length == 0 || m < factor_length || n < factor_length )
+	{
+		return collector.finish ();
+	}
+
+	FUZZY_STATS_ADD ( bytes_scanned, n );
+
+	fuzzy::ArenaScope scope;
+	fuzzy::ResourceAllocator<unsigned char> allocator ( fuzzy::query_resource () );
+
+	CountersBlock counters_block = counters_kernel ().block;
+	ScratchBuffer<unsigned char> carry ( m + 1, 0, allocator );
+	ScratchBuffer<unsigned char> line ( std::min ( n, (size_t) BATCH_BLOCK_SIZE ) + 1, 0, allocator );
+
+	size_t begin, end;
+	for ( begin = 0; begin < n; begin = end )
+	{
+		end = std::min ( n, begin + BATCH_BLOCK_SIZE );
+
+		counters_block ( t, begin, end, x, m, factor_length, &carry[0], &line[0], collector );
+		FUZZY_STATS_ADD ( cells, (unsigned long long) ( end - begin ) * m );
+	}
+
+	return collector.finish ();
+}
+
+#endif
+
+/**
+ * Picks the fastest Hamming distance kernel for the factor length and error
+ * limit: the SIMD diagonal counters when compiled in and the factor fits a
+ * byte counter, the mismatch rings for small max_error, and the error arrays
+ * otherwise.
+ */
+static ResultTupleSet flasm_hd_search ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, ResultCollector & collector )
+{
+#ifdef FLASM_SIMD
+	if ( factor_length <= UCHAR_MAX )
+	{
+		return flasm_hd_scan_counters ( t, n, x, m, factor_length, collector );
+	}
+#endif
+
+	if ( max_error <= DIAGONAL_MAX_ERROR )
+	{
+		return flasm_hd_scan_diagonals ( t, n, x, m, factor_length, collector );
+	}
+
+	return flasm_hd_scan ( t, n, x, m, factor_length, collector );
+}
+
+/**
+ * This is the libFLASM Hamming distance function.
+ *
+ * @param t The text (haystack) to search in
+ * @param n The length of t
+ * @param x The pattern which has factors that may be present in t
+ * @param m The length of x
+ * @param factor_length The length of a factor (needle)
+ * @param max_error The maximum distance between the factor and a position in t to report
+ * @param return_all Return all matches or just the first best one
+ * @return The discovered positions are returned in a set that can be iterated over
+ */
+ResultTupleSet libflasm::flasm_hd ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, bool return_all )
+{
+	ResultCollector collector ( return_all ? ResultCollector::ALL : ResultCollector::BEST, max_error, m );
+
+	return flasm_hd_search ( t, n, x, m, factor_length, max_error, collector );
+}
+
+/**
+ * This is the libFLASM Hamming distance function in top-k mode. The top_k best
+ * results are taken over all (pos_t, pos_x) pairs of the text, not per factor,
+ * so a factor with many good matches can take every place.
+ *
+ * @param t The text (haystack) to search in
+ * @param n The length of t
+ * @param x The pattern which has factors that may be present in t
+ * @param m The length of x
+ * @param factor_length The length of a factor (needle)
+ * @param max_error The maximum distance between the factor and a position in t to report
+ * @param top_k The number of best matches to return
+ * @return The top_k best (pos_t, pos_x) pairs, ordered as ResultTuple, in a set that can be iterated over
+ */
+ResultTupleSet libflasm::flasm_hd_topk ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, unsigned int top_k )
+{
+	if ( top_k == 0 )
+	{
+		return ResultTupleSet ();
+	}
+
+	ResultCollector collector ( ResultCollector::TOP_K, max_error, m, top_k );
+
+	return flasm_hd_search ( t, n, x, m, factor_length, max_error, collector );
+}
+
+
+/**
+ * The bit-vectors and score of Myers' algorithm for a single factor of at
+ * most WORD_SIZE characters, kept between text blocks of a batch
+ */
+struct MyersState
+{
+	WORD VP;
+	WORD VN;
+	unsigned int score;
+};
+
+/**
+ * Advances the Myers state of one factor through the text block t[begin..end)
+ * and reports every end position within the collector threshold.
+ *
+ * @param peq Match masks of the factor, indexed by character
+ * @param high The bit of the last factor character
+ */
+static void myers_block ( unsigned char * t, size_t begin, size_t end, WORD * peq, WORD high, size_t pos_x, MyersState & state, ResultCollector & collector )
+{
+	WORD VP = state.VP;
+	WORD VN = state.VN;
+	unsigned int score = state.score;
+	unsigned int max_error = collector.threshold ();
 
-							best.pos_x = i - 1;
+	size_t j;
+	for ( j = begin; j < end; j++ )
+	{
+		WORD Eq = peq[t[j]];
+		WORD Xv = Eq | VN;
+		WORD Xh = ( ( ( Eq & VP ) + VP ) ^ VP ) | Eq;
+		WORD Ph = VN | ~ ( Xh | VP );
+		WORD Mh = VP & Xh;
+
+		if ( Ph & high )
+		{
+			score++;
+		}
+		else if ( Mh & high )
+		{
+			score--;
+		}
+
+		//the text is searched, so no error enters at the top of the column
+		Ph <<= 1;
+		Mh <<= 1;
+		VP = Mh | ~ ( Xv | Ph );
+		VN = Ph & Xv;
+
+		if ( score <= max_error )
+		{
+			collector.add ( j, pos_x, score );
+			max_error = collector.threshold ();
+		}
+	}
+
+	state.VP = VP;
+	state.VN = VN;
+	state.score = score;
 
-							best.error = err;
+	FUZZY_STATS_ADD ( myers_blocks, end - begin );
+}
+
+/**
+ * This is the libFLASM edit distance function for a batch of patterns.
+ *
+ * The text is read in blocks of BATCH_BLOCK_SIZE characters and the Myers
+ * state of every factor of every query is advanced through a block before the
+ * next one is read, so each block stays cache-resident while the whole batch
+ * is matched against it. Queries whose factors are longer than WORD_SIZE are
+ * searched with flasm_ed one at a time.
+ *
+ * @param t The text (haystack) to search in
+ * @param n The length of t
+ * @param queries The patterns which have factors that may be present in t
+ * @param factor_length The length of a factor (needle)
+ * @param max_error The maximum distance between the factor and a position in t to report
+ * @param return_all Return all matches or just the first best one for each query
+ * @return One set of discovered positions per query, in the order of queries
+ */
+ResultTupleSets libflasm::flasm_ed_batch ( unsigned char * t, size_t n, const std::vector<Query> & queries, size_t factor_length, unsigned int max_error, bool return_all )
+{
+	ResultTupleSets results ( queries.size () );
+
+	std::vector<ResultCollector> collectors;
+	std::vector<std::vector<MyersState> > states ( queries.size () );
+
+	size_t q, i;
+	for ( q = 0; q < queries.size (); q++ )
+	{
+		collectors.push_back ( ResultCollector ( return_all ? ResultCollector::ALL : ResultCollector::BEST, max_error, queries[q].m ) );
+
+		if ( factor_length == 0 || queries[q].m < factor_length )
+		{
+			continue;
+		}
+
+		if ( factor_length > WORD_SIZE )
+		{
+			results[q] = flasm_ed_scan ( t, n, queries[q].x, queries[q].m, factor_length, collectors[q] );
+			continue;
+		}
+
+		MyersState initial = { ~ (WORD) 0, 0, (unsigned int) factor_length };
+		states[q].assign ( queries[q].m - factor_length + 1, initial );
+	}
+
+	//empty factors match nowhere and longer ones than WORD_SIZE were scanned above
+	if ( factor_length == 0 || factor_length > WORD_SIZE )
+	{
+		return results;
+	}
+
+	WORD high = (WORD) 1 << ( factor_length - 1 );
+	WORD peq[UCHAR_MAX + 1] = { 0 };
+
+	FUZZY_STATS_ADD ( bytes_scanned, n );
+
+	size_t begin, end;
+	for ( begin = 0; begin < n; begin = end )
+	{
+		end = std::min ( n, begin + BATCH_BLOCK_SIZE );
+
+		for ( q = 0; q < queries.size (); q++ )
+		{
+			unsigned char * x = queries[q].x;
+
+			for ( i = 0; i < states[q].size (); i++ )
+			{
+				size_t k;
+				for ( k = 0; k < factor_length; k++ )
+				{
+					peq[x[i + k]] |= (WORD) 1 << k;
+				}
+
+				myers_block ( t, begin, end, peq, high, i + factor_length - 1, states[q][i], collectors[q] );
+				FUZZY_STATS_ADD ( cells, (unsigned long long) ( end - begin ) * factor_length );
+
+				for ( k = 0; k < factor_length; k++ )
+				{
+					peq[x[i + k]] = 0;
+				}
+			}
+		}
+	}
+
+	for ( q = 0; q < queries.size (); q++ )
+	{
+		if ( !states[q].empty () )
+		{
+			results[q] = collectors[q].finish ();
+		}
+	}
+
+	return results;
+}
+
+#ifdef FLASM_SIMD
+
+/**
+ * Runs a batch of FLASM Hamming distance searches with the SIMD diagonal
+ * counters, carrying the counters of the last column of every query from one
+ * text block to the next. Needs factor_length <= UCHAR_MAX.
+ */
+static ResultTupleSets flasm_hd_batch_counters ( unsigned char * t, size_t n, const std::vector<Query> & queries, size_t factor_length, unsigned int max_error, bool return_all )
+{
+	ResultTupleSets results ( queries.size () );
+
+	CountersBlock counters_block = counters_kernel ().block;
+	std::vector<ResultCollector> collectors;
+	std::vector<std::vector<unsigned char> > carries ( queries.size () );
+	std::vector<unsigned char> line ( BATCH_BLOCK_SIZE + 1 );
+
+	size_t q;
+	for ( q = 0; q < queries.size (); q++ )
+	{
+		collectors.push_back ( ResultCollector ( return_all ? ResultCollector::ALL : ResultCollector::BEST, max_error, queries[q].m ) );
+
+		if ( queries[q].m >= factor_length )
+		{
+			carries[q].assign ( queries[q].m + 1, 0 );
+		}
+	}
+
+	FUZZY_STATS_ADD ( bytes_scanned, n );
+
+	size_t begin, end;
+	for ( begin = 0; begin < n; begin = end )
+	{
+		end = std::min ( n, begin + BATCH_BLOCK_SIZE );
+
+		for ( q = 0; q < queries.size (); q++ )
+		{
+			if ( !carries[q].empty () )
+			{
+				counters_block ( t, begin, end, queries[q].x, queries[q].m, factor_length, &carries[q][0], &line[0], collectors[q] );
+				FUZZY_STATS_ADD ( cells, (unsigned long long) ( end - begin ) * queries[q].m );
+			}
+		}
+	}
+
+	for ( q = 0; q < queries.size (); q++ )
+	{
+		if ( !carries[q].empty () )
+		{
+			results[q] = collectors[q].finish ();
+		}
+	}
+
+	return results;
+}
+
+#endif
+
+/**
+ * Runs the FLASM Hamming distance search of a batch of queries with error
+ * arrays over blocks of BATCH_BLOCK_SIZE columns of t, carrying the last column
+ * of each query over to the next block, so that its memory does not grow with
+ * n. Passes the matches of queries[q] to collectors[q] and skips the queries
+ * shorter than factor_length.
+ */
+static void flasm_hd_scan_blocks ( unsigned char * t, size_t n, const std::vector<Query> & queries, size_t factor_length, ResultCollector * collectors )
+{
+	fuzzy::ArenaScope scope;
+	fuzzy::ResourceAllocator<WORD> allocator ( fuzzy::query_resource () );
+
+	libflasm::Limit lim;
+	lim = init_limit ( factor_length, lim );
+
+	std::vector<std::vector<WORD> > columns ( queries.size () );
+	ScratchBuffer<WORD> ones ( lim.words, 0, allocator );
+
+	size_t q, i, j;
+	unsigned int err;
+	for ( q = 0; q < queries.size (); q++ )
+	{
+		if ( queries[q].m < factor_length )
+		{
+			continue;
+		}
+
+		//the first column holds ones up to length h
+		columns[q].assign ( ( queries[q].m + 1 ) * lim.words, 0 );
+		std::fill ( ones.begin (), ones.end (), 0 );
+		for ( i = 1; i < queries[q].m + 1; i++ )
+		{
+			if ( i <= factor_length )
+			{
+				shift_words ( &ones[0], lim.words );
+				ones[lim.words - 1] = ones[lim.words - 1] + 1;
+			}
+			std::copy ( ones.begin (), ones.end (), columns[q].begin () + i * lim.words );
+		}
+	}
+
+	//2 line matrix over a block, the first cell of each line is the carried column
+	ScratchBuffer<WORD> M0 ( ( BATCH_BLOCK_SIZE + 1 ) * lim.words, 0, allocator );
+	ScratchBuffer<WORD> M1 ( ( BATCH_BLOCK_SIZE + 1 ) * lim.words, 0, allocator );
+
+	FUZZY_STATS_ADD ( bytes_scanned, n );
+
+	size_t begin, end;
+	for ( begin = 0; begin < n; begin = end )
+	{
+		end = std::min ( n, begin + BATCH_BLOCK_SIZE );
+
+		for ( q = 0; q < queries.size (); q++ )
+		{
+			if ( columns[q].empty () )
+			{
+				continue;
+			}
+
+			unsigned char * x = queries[q].x;
+			WORD * prev = &M0[0];
+			WORD * curr = &M1[0];
+			FUZZY_STATS_ADD ( cells, (unsigned long long) ( end - begin ) * queries[q].m );
+
+			//the line of x = 0 is all zeros
+			std::fill ( M0.begin (), M0.begin () + ( end - begin + 1 ) * lim.words, 0 );
+
+			for ( i = 1; i < queries[q].m + 1; i++ ) //loop through x
+			{
+				WORD * column = &columns[q][i * lim.words];
+
+				memcpy ( curr, column, lim.words * sizeof ( WORD ) );
+
+				for ( j = begin + 1; j < end + 1; j++ ) //loop through the block of t
+				{
+					WORD * cell = curr + ( j - begin ) * lim.words;
+
+					//copy values from diagonal cell into current cell
+					memcpy ( cell, prev + ( j - begin - 1 ) * lim.words, lim.words * sizeof ( WORD ) );
+
+					//shift things along one and clear left most bit
+					shiftc_words ( cell, lim );
+
+					//set last bit on right to hamming distance of the characters
+					cell[lim.words - 1] = cell[lim.words - 1] | delta ( x[i - 1], t[j - 1] );
+
+					if ( j >= factor_length && i >= factor_length )
+					{
+						err = popcount_words ( cell, lim.words );
+
+						if ( err <= collectors[q].threshold () )
+						{
+							collectors[q].add ( j - 1, i - 1, err );
 						}
 					}
 				}
-				break;
+
+				//carry the last column of this line over to the next block
+				memcpy ( column, curr + ( end - begin ) * lim.words, lim.words * sizeof ( WORD ) );
+
+				std::swap ( prev, curr );
 			}
 		}
 	}
+}
+
+/**
+ * This is the libFLASM Hamming distance function for a batch of patterns.
+ *
+ * The text is read in blocks of BATCH_BLOCK_SIZE characters. For every query
+ * the SIMD diagonal counters or error arrays of the last text column are kept
+ * between blocks, so each block is matched against the whole batch while it
+ * stays cache-resident.
+ *
+ * @param t The text (haystack) to search in
+ * @param n The length of t
+ * @param queries The patterns which have factors that may be present in t
+ * @param factor_length The length of a factor (needle)
+ * @param max_error The maximum distance between the factor and a position in t to report
+ * @param return_all Return all matches or just the first best one for each query
+ * @return One set of discovered positions per query, in the order of queries
+ */
+ResultTupleSets libflasm::flasm_hd_batch ( unsigned char * t, size_t n, const std::vector<Query> & queries, size_t factor_length, unsigned int max_error, bool return_all )
+{
+	ResultTupleSets results ( queries.size () );
+
+	if ( factor_length == 0 )
+	{
+		return results;
+	}
+
+#ifdef FLASM_SIMD
+	if ( factor_length <= UCHAR_MAX )
+	{
+		return flasm_hd_batch_counters ( t, n, queries, factor_length, max_error, return_all );
+	}
+#endif
+
+	std::vector<ResultCollector> collectors;
+
+	size_t q;
+	for ( q = 0; q < queries.size (); q++ )
+	{
+		collectors.push_back ( ResultCollector ( return_all ? ResultCollector::ALL : ResultCollector::BEST, max_error, queries[q].m ) );
+	}
 
-	for ( j = 0; j < n + 1; j ++ ) 
+	if ( !queries.empty () )
 	{
-		free ( M0[j] );
-		free ( M1[j] );
+		flasm_hd_scan_blocks ( t, n, queries, factor_length, &collectors[0] );
 	}
-	free ( M0 );
-	free ( M1 );
-	free ( ones );
 
-	if ( !return_all && best.error != m )
+	for ( q = 0; q < queries.size (); q++ )
 	{
-		results.insert( best );
+		if ( queries[q].m >= factor_length )
+		{
+			results[q] = collectors[q].finish ();
+		}
 	}
 
 	return results;
 }
+
+/**
+ * This is the libFLASM Hamming distance function within a memory budget.
+ *
+ * The working memory of the kernel flasm_hd would pick is charged to budget
+ * for the search. When its 2 ( n + 1 ) error arrays do not fit, the text is
+ * streamed through the error arrays of a block instead. With return_all every
+ * match found is charged as well, until the set of matches is returned.
+ *
+ * @param t The text (haystack) to search in
+ * @param n The length of t
+ * @param x The pattern which has factors that may be present in t
+ * @param m The length of x
+ * @param factor_length The length of a factor (needle)
+ * @param max_error The maximum distance between the factor and a position in t to report
+ * @param return_all Return all matches or just the first best one
+ * @param budget The memory budget, whose peak includes this search
+ * @return The discovered positions are returned in a set that can be iterated over
+ * @throws fuzzy::BudgetExceeded if the search or its matches do not fit in budget
+ */
+ResultTupleSet libflasm::flasm_hd ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, bool return_all, fuzzy::MemoryBudget & budget )
+{
+	ResultCollector collector ( return_all ? ResultCollector::ALL : ResultCollector::BEST, max_error, m, 0, &budget );
+
+#ifdef FLASM_SIMD
+	if ( factor_length <= UCHAR_MAX )
+	{
+		fuzzy::BudgetCharge counters ( &budget, m + std::min ( n, (size_t) BATCH_BLOCK_SIZE ) + 2 );
+		return flasm_hd_scan_counters ( t, n, x, m, factor_length, collector );
+	}
+#endif
+
+	if ( max_error <= DIAGONAL_MAX_ERROR )
+	{
+		fuzzy::BudgetCharge ring ( &budget, ( std::min ( (size_t) max_error, factor_length ) + 1 ) * sizeof ( size_t ) );
+		return flasm_hd_scan_diagonals ( t, n, x, m, factor_length, collector );
+	}
+
+	libflasm::Limit lim;
+	lim = init_limit ( factor_length, lim );
+
+	size_t arrays = 2 * ( n + 1 ) * ( sizeof ( WORD * ) + lim.words * sizeof ( WORD ) ) + lim.words * sizeof ( WORD );
+	if ( budget.fits ( arrays ) )
+	{
+		fuzzy::BudgetCharge error_arrays ( &budget, arrays );
+		return flasm_hd_scan ( t, n, x, m, factor_length, collector );
+	}
+
+	if ( factor_length == 0 || m < factor_length )
+	{
+		return collector.finish ();
+	}
+
+	//the carried column, the first column and the 2 lines of a block
+	size_t blocks = ( ( m + 2 ) + 2 * ( BATCH_BLOCK_SIZE + 1 ) ) * lim.words * sizeof ( WORD );
+	fuzzy::BudgetCharge block_arrays ( &budget, blocks );
+
+	std::vector<Query> queries ( 1 );
+	queries[0].x = x;
+	queries[0].m = m;
+	flasm_hd_scan_blocks ( t, n, queries, factor_length, &collector );
+
+	return collector.finish ();
+}
+
+/**
+ * This is the libFLASM edit distance function within a memory budget.
+ *
+ * The Myers bit-vectors of a factor are charged to budget for the search and,
+ * with return_all, every match found as well, until the set of matches is
+ * returned. The text is searched in place, so nothing else grows with n.
+ *
+ * @param t The text (haystack) to search in
+ * @param n The length of t
+ * @param x The pattern which has factors that may be present in t
+ * @param m The length of x
+ * @param factor_length The length of a factor (needle)
+ * @param max_error The maximum distance between the factor and a position in t to report
+ * @param return_all Return all matches or just the first best one
+ * @param budget The memory budget, whose peak includes this search
+ * @return The discovered positions are returned in a set that can be iterated over
+ * @throws fuzzy::BudgetExceeded if the search or its matches do not fit in budget
+ */
+ResultTupleSet libflasm::flasm_ed ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, bool return_all, fuzzy::MemoryBudget & budget )
+{
+	ResultCollector collector ( return_all ? ResultCollector::ALL : ResultCollector::BEST, max_error, m, 0, &budget );
+
+	//one bit mask per character and the vertical deltas of every block of the factor
+	size_t blocks = ( factor_length + WORD_SIZE - 1 ) / WORD_SIZE;
+	fuzzy::BudgetCharge myers ( &budget, ( UCHAR_MAX + 1 + 4 ) * blocks * sizeof ( WORD ) + factor_length );
+
+	return flasm_ed_scan ( t, n, x, m, factor_length, collector );
+}
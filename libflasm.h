@@ -24,8 +24,12 @@
 #include <cstdlib>
 #include <cmath>
 #include <limits.h>
+#include <algorithm>
+#include <vector>
 
 #include "seqan/find.h"
+#include "fuzzy_search/memory.h"
+#include "fuzzy_search/stats.h"
 
 using namespace std;
 using namespace seqan;
@@ -56,22 +60,62 @@ namespace libflasm
     // stores a single result tuple and provides comparator (operator) function for sorting results
     struct ResultTuple {
 	bool operator() (const ResultTuple& a, const ResultTuple& b) const {return ( a.error < b.error ) || ( a.error == b.error && a.pos_t < b.pos_t ) || ( a.error == b.error && a.pos_t == b.pos_t && a.pos_x < b.pos_x );};
-	unsigned int pos_t;
-	unsigned int pos_x;
+	size_t pos_t;
+	size_t pos_x;
 	unsigned int error;
     };
 
+    // zero-copy view over the text, which may be a memory-mapped buffer of any size
+    typedef ContainerView<CharString> TextView;
+
     // resultset
     typedef std::multiset<ResultTuple,ResultTuple> ResultTupleSet;
 
     // resultset iterator
     typedef ResultTupleSet::iterator ResultTupleSetIterator; 
 
+    // a single pattern of a batch searched against the same text
+    struct Query
+    {
+	unsigned char * x;
+	size_t m;
+    };
+
+    // one resultset per query of a batch, in the order of the queries
+    typedef std::vector<ResultTupleSet> ResultTupleSets;
+
+    // number of text characters every query of a batch is advanced through at a time
+    #define BATCH_BLOCK_SIZE 16384
+
+    // largest max_error for which the Hamming search counts mismatches along diagonals instead of building error arrays
+    #define DIAGONAL_MAX_ERROR 4
+
+    // instruction set of the SIMD Hamming distance kernel selected for this CPU: "avx512", "avx2", "sse2" or "none"
+    const char * flasm_simd_kernel ();
+
     // FLASM Edit distance
-    ResultTupleSet flasm_ed ( unsigned char * t, unsigned int n, unsigned char * x, unsigned int m, unsigned int factor_length, unsigned int max_error, bool return_all );
+    ResultTupleSet flasm_ed ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, bool return_all );
 
     // FLASM Hamming distance
-    ResultTupleSet flasm_hd ( unsigned char * t, unsigned int n, unsigned char * x, unsigned int m, unsigned int factor_length, unsigned int max_error, bool return_all );
+    ResultTupleSet flasm_hd ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, bool return_all );
+
+    // FLASM Edit distance within a memory budget, throws fuzzy::BudgetExceeded if it does not fit
+    ResultTupleSet flasm_ed ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, bool return_all, fuzzy::MemoryBudget & budget );
+
+    // FLASM Hamming distance within a memory budget, streaming the text when the error arrays do not fit
+    ResultTupleSet flasm_hd ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, bool return_all, fuzzy::MemoryBudget & budget );
+
+    // FLASM Edit distance, keeping only the top_k best results over all (pos_t, pos_x) pairs, not per factor
+    ResultTupleSet flasm_ed_topk ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, unsigned int top_k );
+
+    // FLASM Hamming distance, keeping only the top_k best results over all (pos_t, pos_x) pairs, not per factor
+    ResultTupleSet flasm_hd_topk ( unsigned char * t, size_t n, unsigned char * x, size_t m, size_t factor_length, unsigned int max_error, unsigned int top_k );
+
+    // FLASM Edit distance for a batch of patterns against the same text
+    ResultTupleSets flasm_ed_batch ( unsigned char * t, size_t n, const std::vector<Query> & queries, size_t factor_length, unsigned int max_error, bool return_all );
+
+    // FLASM Hamming distance for a batch of patterns against the same text
+    ResultTupleSets flasm_hd_batch ( unsigned char * t, size_t n, const std::vector<Query> & queries, size_t factor_length, unsigned int max_error, bool return_all );
 
 }
 
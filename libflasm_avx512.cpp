@@ -0,0 +1,26 @@
+/**
+    libFLASM
+    Copyright (C) 2016 Lorraine A. K. Ayad, Solon P. Pissis and Ahmad Retha
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+// SIMD kernels built for AVX-512BW (-mavx512f -mavx512bw)
+
+#ifdef __AVX512BW__
+
+#define FLASM_COUNTERS_BLOCK counters_block_avx512
+#include "libflasm_counters.h"
+
+#endif
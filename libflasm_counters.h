@@ -0,0 +1,159 @@
+/**
+    libFLASM
+    Copyright (C) 2016 Lorraine A. K. Ayad, Solon P. Pissis and Ahmad Retha
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/**
+ * Body of the SIMD diagonal counter kernel. It is included once by each of
+ * libflasm_sse2.cpp, libflasm_avx2.cpp and libflasm_avx512.cpp, which define
+ * FLASM_COUNTERS_BLOCK to the name of the kernel and are compiled with the
+ * matching instruction set; the byte vector primitives below pick the widest
+ * one the unit is compiled for.
+ */
+
+#include <string.h>
+#include <limits.h>
+#include <immintrin.h>
+
+#include "libflasm_simd.h"
+
+namespace
+{
+
+#if defined ( __AVX512BW__ )
+typedef __m512i BYTES;
+typedef unsigned long long BYTES_MASK;
+#define BYTES_LANES 64
+inline BYTES bytes_load ( const unsigned char * p ) { return _mm512_loadu_si512 ( ( const void * ) p ); }
+inline void bytes_store ( unsigned char * p, BYTES v ) { _mm512_storeu_si512 ( ( void * ) p, v ); }
+inline BYTES bytes_set ( unsigned char c ) { return _mm512_set1_epi8 ( ( char ) c ); }
+inline BYTES bytes_add ( BYTES a, BYTES b ) { return _mm512_add_epi8 ( a, b ); }
+inline BYTES bytes_sub ( BYTES a, BYTES b ) { return _mm512_sub_epi8 ( a, b ); }
+inline BYTES bytes_delta ( BYTES a, BYTES b ) { return _mm512_maskz_set1_epi8 ( _mm512_cmpneq_epi8_mask ( a, b ), 1 ); }
+inline BYTES_MASK bytes_le ( BYTES a, BYTES b ) { return _mm512_cmple_epu8_mask ( a, b ); }
+#elif defined ( __AVX2__ )
+typedef __m256i BYTES;
+typedef unsigned int BYTES_MASK;
+#define BYTES_LANES 32
+inline BYTES bytes_load ( const unsigned char * p ) { return _mm256_loadu_si256 ( ( const __m256i * ) p ); }
+inline void bytes_store ( unsigned char * p, BYTES v ) { _mm256_storeu_si256 ( ( __m256i * ) p, v ); }
+inline BYTES bytes_set ( unsigned char c ) { return _mm256_set1_epi8 ( ( char ) c ); }
+inline BYTES bytes_add ( BYTES a, BYTES b ) { return _mm256_add_epi8 ( a, b ); }
+inline BYTES bytes_sub ( BYTES a, BYTES b ) { return _mm256_sub_epi8 ( a, b ); }
+inline BYTES bytes_delta ( BYTES a, BYTES b ) { return _mm256_andnot_si256 ( _mm256_cmpeq_epi8 ( a, b ), _mm256_set1_epi8 ( 1 ) ); }
+inline BYTES_MASK bytes_le ( BYTES a, BYTES b ) { return ( BYTES_MASK ) _mm256_movemask_epi8 ( _mm256_cmpeq_epi8 ( _mm256_min_epu8 ( a, b ), a ) ); }
+#else
+typedef __m128i BYTES;
+typedef unsigned int BYTES_MASK;
+#define BYTES_LANES 16
+inline BYTES bytes_load ( const unsigned char * p ) { return _mm_loadu_si128 ( ( const __m128i * ) p ); }
+inline void bytes_store ( unsigned char * p, BYTES v ) { _mm_storeu_si128 ( ( __m128i * ) p, v ); }
+inline BYTES bytes_set ( unsigned char c ) { return _mm_set1_epi8 ( ( char ) c ); }
+inline BYTES bytes_add ( BYTES a, BYTES b ) { return _mm_add_epi8 ( a, b ); }
+inline BYTES bytes_sub ( BYTES a, BYTES b ) { return _mm_sub_epi8 ( a, b ); }
+inline BYTES bytes_delta ( BYTES a, BYTES b ) { return _mm_andnot_si128 ( _mm_cmpeq_epi8 ( a, b ), _mm_set1_epi8 ( 1 ) ); }
+inline BYTES_MASK bytes_le ( BYTES a, BYTES b ) { return ( BYTES_MASK ) _mm_movemask_epi8 ( _mm_cmpeq_epi8 ( _mm_min_epu8 ( a, b ), a ) ); }
+#endif
+
+inline unsigned char mismatch ( unsigned char a, unsigned char b ) { return a != b; }
+
+}
+
+/**
+ * Advances the diagonal mismatch counters of one pattern through the columns
+ * begin + 1 .. end of the (x, t) matrix. The counter of cell (i, j) holds the
+ * number of mismatches of the factor of x ending at i against t ending at j;
+ * it is the counter of cell (i - 1, j - 1) plus the new mismatch minus the one
+ * leaving the factor window, so BYTES_LANES diagonals are advanced per vector.
+ *
+ * @param carry The counters of column begin for rows 0 .. m, updated to column end
+ * @param line A buffer of at least end - begin + 1 counters
+ */
+void libflasm::FLASM_COUNTERS_BLOCK ( unsigned char * t, size_t begin, size_t end, unsigned char * x, size_t m, size_t factor_length, unsigned char * carry, unsigned char * line, ResultCollector & collector )
+{
+	size_t h = factor_length;
+	size_t length = end - begin;
+	size_t i, jj;
+
+	//the line of x = 0 is all zeros
+	memset ( line, 0, length + 1 );
+
+	unsigned char diagonal = carry[0];
+	for ( i = 1; i < m + 1; i++ ) //loop through x
+	{
+		//line[0] is column begin of the previous line, carried over from the previous block
+		unsigned char next = carry[i];
+		line[0] = diagonal;
+		diagonal = next;
+
+		unsigned int threshold = collector_threshold ( collector );
+		BYTES limit = bytes_set ( ( unsigned char ) ( threshold < UCHAR_MAX ? threshold : UCHAR_MAX ) );
+		BYTES enter = bytes_set ( x[i - 1] );
+		BYTES leave = bytes_set ( i > h ? x[i - 1 - h] : 0 );
+
+		//right to left, so that line[jj - 1] still belongs to the previous line
+		jj = length;
+		while ( jj >= BYTES_LANES && ( i <= h || begin + jj - BYTES_LANES + 1 > h ) )
+		{
+			size_t a = jj - BYTES_LANES + 1;
+
+			BYTES counters = bytes_add ( bytes_load ( &line[a - 1] ), bytes_delta ( enter, bytes_load ( &t[begin + a - 1] ) ) );
+			if ( i > h )
+			{
+				counters = bytes_sub ( counters, bytes_delta ( leave, bytes_load ( &t[begin + a - 1 - h] ) ) );
+			}
+			bytes_store ( &line[a], counters );
+
+			if ( i >= h )
+			{
+				BYTES_MASK hits = bytes_le ( counters, limit );
+				while ( hits )
+				{
+					unsigned int lane = __builtin_ctzll ( hits );
+					hits &= hits - 1;
+
+					size_t j = begin + a + lane;
+					if ( j >= h && line[a + lane] <= collector_threshold ( collector ) )
+					{
+						collector_add ( collector, j - 1, i - 1, line[a + lane] );
+					}
+				}
+			}
+
+			jj -= BYTES_LANES;
+		}
+
+		for ( ; jj > 0; jj-- )
+		{
+			size_t j = begin + jj;
+
+			unsigned char counter = line[jj - 1] + mismatch ( x[i - 1], t[j - 1] );
+			if ( i > h && j > h )
+			{
+				counter -= mismatch ( x[i - 1 - h], t[j - 1 - h] );
+			}
+			line[jj] = counter;
+
+			if ( i >= h && j >= h && counter <= threshold )
+			{
+				collector_add ( collector, j - 1, i - 1, counter );
+				threshold = collector_threshold ( collector );
+			}
+		}
+
+		carry[i] = line[length];
+	}
+}
@@ -0,0 +1,61 @@
+/**
+    libFLASM
+    Copyright (C) 2016 Lorraine A. K. Ayad, Solon P. Pissis and Ahmad Retha
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/**
+ * Internal interface between libflasm.cpp and the SIMD kernels, which are
+ * compiled once per instruction set (libflasm_sse2.cpp, libflasm_avx2.cpp,
+ * libflasm_avx512.cpp) and selected at startup.
+ *
+ * The kernel units are built with wider instruction sets than the rest of the
+ * library, so they must not share inline functions or templates with it: the
+ * linker could keep their copy and run it on a CPU without those instructions.
+ * This header therefore includes no library headers and the kernels reach the
+ * ResultCollector only through the out-of-line functions below.
+ */
+
+#ifndef __LIBFLASM_SIMD__
+#define __LIBFLASM_SIMD__
+
+#include <stddef.h>
+
+class ResultCollector;
+
+namespace libflasm
+{
+
+    // largest error a match may have to still be collected
+    unsigned int collector_threshold ( const ResultCollector & collector );
+
+    // passes a match to the collector
+    void collector_add ( ResultCollector & collector, size_t pos_t, size_t pos_x, unsigned int error );
+
+    /**
+    * Advances the diagonal mismatch counters of one pattern through the columns
+    * begin + 1 .. end of the (x, t) matrix
+    */
+    typedef void ( * CountersBlock ) ( unsigned char * t, size_t begin, size_t end, unsigned char * x, size_t m, size_t factor_length, unsigned char * carry, unsigned char * line, ResultCollector & collector );
+
+    void counters_block_sse2 ( unsigned char * t, size_t begin, size_t end, unsigned char * x, size_t m, size_t factor_length, unsigned char * carry, unsigned char * line, ResultCollector & collector );
+
+    void counters_block_avx2 ( unsigned char * t, size_t begin, size_t end, unsigned char * x, size_t m, size_t factor_length, unsigned char * carry, unsigned char * line, ResultCollector & collector );
+
+    void counters_block_avx512 ( unsigned char * t, size_t begin, size_t end, unsigned char * x, size_t m, size_t factor_length, unsigned char * carry, unsigned char * line, ResultCollector & collector );
+
+}
+
+#endif
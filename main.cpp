@@ -26,8 +26,9 @@ auto result2 = fuzzy_search(data.begin(), data.end(), search.begin(), search.end
     auto start = std::chrono::system_clock::now();
 
     const int times = 1000;
+    libflasm::ResultTupleSet result3;
     for(size_t i = 0; i < times; ++i)
-    auto result3 = libflasm::flasm_ed(reinterpret_cast<unsigned char*>(const_cast<char*>(data.c_str())), data.length(),
+    result3 = libflasm::flasm_ed(reinterpret_cast<unsigned char*>(const_cast<char*>(data.c_str())), data.length(),
                                       reinterpret_cast<unsigned char*>(const_cast<char*>(search.c_str())), search.length(),
                                       search.length(), 1, false);
     //auto result = bitap_fuzzy_bitwise_search_new(data, search, 1);
@@ -0,0 +1,406 @@
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Randl_fuzzy_search.hpp"
+#include "Bitap.hpp"
+#include "libflasm.h"
+#include "FuzzySearcher.hpp"
+
+/**
+ * Per-call latency and allocations of every engine on short records (names,
+ * SKUs, 16..128 bytes), where building the pattern tables costs more than the
+ * scan itself: Bitap's pattern_mask, fuzzy_search's symbol sets and q-gram
+ * maps, libflasm's counters and SeqAn's setNeedle.
+ *
+ * Each iteration searches the next record of a fixed set with a new query, so
+ * the engines pay their full setup on every call. Besides the time per call,
+ * every benchmark reports the counters
+ *   allocs  heap allocations per call
+ *   bytes   heap bytes requested per call
+ * counted by the allocation hooks below.
+ */
+
+namespace
+{
+
+std::atomic<unsigned long long> allocation_count(0);
+std::atomic<unsigned long long> allocation_bytes(0);
+
+inline void count_allocation(size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+// allocation hooks: with glibc the C allocator is interposed, which covers
+// operator new as well as libflasm's calloc; elsewhere only operator new
+#if defined(__GLIBC__)
+
+extern "C"
+{
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void * pointer, size_t size);
+
+void * malloc(size_t size)
+{
+    count_allocation(size);
+    return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size)
+{
+    count_allocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void * realloc(void * pointer, size_t size)
+{
+    count_allocation(size);
+    return __libc_realloc(pointer, size);
+}
+}
+
+#else
+
+void * operator new(size_t size)
+{
+    count_allocation(size);
+    if (void * pointer = std::malloc(size != 0 ? size : 1))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void * operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void * pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void * pointer) noexcept
+{
+    std::free(pointer);
+}
+
+#endif
+
+namespace
+{
+
+const size_t RECORDS = 256;
+
+// a set of records and the pattern searched in them
+struct ShortInput
+{
+    std::vector<std::string> records;
+    std::string pattern;
+};
+
+struct Engine
+{
+    const char * name;
+    std::function<bool(const std::string & record, const std::string & pattern, size_t k)> supports;
+    std::function<size_t(const std::string & record, const std::string & pattern, size_t k)> run;
+};
+
+/**
+ * Records of upper case letters, digits, dashes and spaces. The pattern is
+ * planted with one substitution into every other record, so half of the
+ * calls find an occurrence.
+ */
+ShortInput generate_input(size_t record_length, size_t pattern_length)
+{
+    static const char symbols[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789- ";
+    std::mt19937 rng(static_cast<unsigned int>(record_length * 1000 + pattern_length));
+    std::uniform_int_distribution<size_t> symbol(0, sizeof(symbols) - 2);
+
+    ShortInput input;
+    input.pattern.resize(pattern_length);
+    for (auto & c : input.pattern)
+    {
+        c = symbols[symbol(rng)];
+    }
+
+    std::uniform_int_distribution<size_t> offset(0, record_length - pattern_length);
+    std::uniform_int_distribution<size_t> error(0, pattern_length - 1);
+    for (size_t i = 0; i < RECORDS; ++i)
+    {
+        std::string record(record_length, ' ');
+        for (auto & c : record)
+        {
+            c = symbols[symbol(rng)];
+        }
+        if (i % 2 == 0)
+        {
+            size_t p = offset(rng);
+            std::copy(input.pattern.begin(), input.pattern.end(), record.begin() + p);
+            record[p + error(rng)] = symbols[symbol(rng)];
+        }
+        input.records.push_back(record);
+    }
+    return input;
+}
+
+template <typename TText, typename TPattern>
+size_t count_seqan(TText & text, TPattern & pattern, int score)
+{
+    seqan::Finder<TText> finder(text);
+    size_t matches = 0;
+    while (seqan::find(finder, pattern, score))
+    {
+        ++matches;
+    }
+    return matches;
+}
+
+// the SeqAn scanners search the record in place, as FuzzySearcher does
+libflasm::TextView view(const std::string & record)
+{
+    char * data = const_cast<char *>(record.data());
+    return libflasm::TextView(data, data + record.size());
+}
+
+std::vector<Engine> all_engines()
+{
+    auto always = [](const std::string &, const std::string &, size_t) { return true; };
+    auto fewer_errors = [](const std::string &, const std::string & pattern, size_t k) { return pattern.size() > k; };
+
+    std::vector<Engine> engines;
+
+    engines.push_back({"bitap",
+                       [](const std::string &, const std::string & pattern, size_t) { return pattern.size() <= 31; },
+                       [](const std::string & record, const std::string & pattern, size_t k) {
+                           size_t matches = 0;
+                           auto it = record.begin();
+                           while (true)
+                           {
+                               auto result = bitap_fuzzy_bitwise_search_new(it, record.end(), pattern.begin(),
+                                                                            pattern.end(), k);
+                               if (result.first == result.second)
+                               {
+                                   return matches;
+                               }
+                               ++matches;
+                               it = result.first + 1;
+                           }
+                       }});
+
+    auto randl_run = [](bool mismatch) {
+        return [mismatch](const std::string & record, const std::string & pattern, size_t k) {
+            return static_cast<size_t>(
+                    fuzzy_search(record.begin(), record.end(), pattern.begin(), pattern.end(), k, mismatch) !=
+                    record.end());
+        };
+    };
+    auto randl_supports = [](fuzzy::Metric metric) {
+        return [metric](const std::string &, const std::string & pattern, size_t k) {
+            return fuzzy::detail::randl_supported(pattern, k, metric);
+        };
+    };
+    engines.push_back({"randl_hd", randl_supports(fuzzy::Metric::Hamming), randl_run(true)});
+    engines.push_back({"randl_ed", randl_supports(fuzzy::Metric::Levenshtein), randl_run(false)});
+
+    engines.push_back({"flasm_hd", always, [](const std::string & record, const std::string & pattern, size_t k) {
+                           return libflasm::flasm_hd(
+                                   reinterpret_cast<unsigned char *>(const_cast<char *>(record.data())), record.size(),
+                                   reinterpret_cast<unsigned char *>(const_cast<char *>(pattern.data())),
+                                   pattern.size(), pattern.size(), k, true).size();
+                       }});
+    engines.push_back({"flasm_ed", always, [](const std::string & record, const std::string & pattern, size_t k) {
+                           return libflasm::flasm_ed(
+                                   reinterpret_cast<unsigned char *>(const_cast<char *>(record.data())), record.size(),
+                                   reinterpret_cast<unsigned char *>(const_cast<char *>(pattern.data())),
+                                   pattern.size(), pattern.size(), k, true).size();
+                       }});
+
+    engines.push_back({"seqan_hamming", always, [](const std::string & record, const std::string & pattern, size_t k) {
+                           seqan::CharString needle = pattern;
+                           seqan::Pattern<seqan::CharString, seqan::HammingSimple> p(needle);
+                           libflasm::TextView text = view(record);
+                           return count_seqan(text, p, -static_cast<int>(k));
+                       }});
+    engines.push_back({"seqan_shiftadd", always, [](const std::string & record, const std::string & pattern, size_t k) {
+                           seqan::CharString needle = pattern;
+                           seqan::Pattern<seqan::CharString, seqan::HammingShiftAdd> p(needle);
+                           libflasm::TextView text = view(record);
+                           return count_seqan(text, p, -static_cast<int>(k));
+                       }});
+    engines.push_back({"seqan_myers", always, [](const std::string & record, const std::string & pattern, size_t k) {
+                           seqan::CharString needle = pattern;
+                           seqan::Pattern<seqan::CharString, seqan::Myers<> > p(needle);
+                           libflasm::TextView text = view(record);
+                           return count_seqan(text, p, -static_cast<int>(k));
+                       }});
+    // the filters take segments of the text and need it as a SeqAn string
+    engines.push_back({"seqan_abndm", fewer_errors, [](const std::string & record, const std::string & pattern, size_t k) {
+                           seqan::CharString needle = pattern;
+                           seqan::CharString text = record;
+                           seqan::Pattern<seqan::CharString, seqan::AbndmAlgo> p(needle, -static_cast<int>(k));
+                           return count_seqan(text, p, -static_cast<int>(k));
+                       }});
+    engines.push_back({"seqan_pex", fewer_errors, [](const std::string & record, const std::string & pattern, size_t k) {
+                           seqan::CharString needle = pattern;
+                           seqan::CharString text = record;
+                           seqan::Pattern<seqan::CharString, seqan::PexNonHierarchical> p(needle, -static_cast<int>(k));
+                           seqan::Finder<seqan::CharString> finder(text);
+                           size_t matches = 0;
+                           while (seqan::find(finder, p))
+                           {
+                               ++matches;
+                           }
+                           return matches;
+                       }});
+
+    auto facade_run = [](fuzzy::Metric metric) {
+        return [metric](const std::string & record, const std::string & pattern, size_t k) {
+            return fuzzy::FuzzySearcher(metric).search(record, pattern, k).size();
+        };
+    };
+    engines.push_back({"auto_hd", always, facade_run(fuzzy::Metric::Hamming)});
+    engines.push_back({"auto_ed", always, facade_run(fuzzy::Metric::Levenshtein)});
+
+    return engines;
+}
+
+void run_short_records(benchmark::State & state, const Engine & engine)
+{
+    const size_t record_length = state.range(0);
+    const size_t pattern_length = state.range(1);
+    const size_t k = state.range(2);
+
+    ShortInput input = generate_input(record_length, pattern_length);
+    std::vector<std::string> records;
+    for (const auto & record : input.records)
+    {
+        if (engine.supports(record, input.pattern, k))
+        {
+            records.push_back(record);
+        }
+    }
+    if (records.empty())
+    {
+        state.SkipWithError("engine does not support these records");
+        return;
+    }
+
+    size_t next = 0;
+    size_t matches = 0;
+    const unsigned long long count_before = allocation_count.load();
+    const unsigned long long bytes_before = allocation_bytes.load();
+    for (auto _ : state)
+    {
+        matches += engine.run(records[next], input.pattern, k);
+        next = next + 1 == records.size() ? 0 : next + 1;
+    }
+    const unsigned long long count_after = allocation_count.load();
+    const unsigned long long bytes_after = allocation_bytes.load();
+    benchmark::DoNotOptimize(matches);
+
+    state.counters["allocs"] = benchmark::Counter(count_after - count_before, benchmark::Counter::kAvgIterations);
+    state.counters["bytes"] = benchmark::Counter(bytes_after - bytes_before, benchmark::Counter::kAvgIterations);
+    state.counters["matches"] = benchmark::Counter(matches, benchmark::Counter::kAvgIterations);
+}
+
+/**
+ * Best score of the pattern in each of the records, as a read mapper verifies
+ * (read, window) pairs: one Myers pattern per pair, or all pairs at once with
+ * myersBatchScores. An iteration verifies all records.
+ */
+void run_record_pairs(benchmark::State & state, bool batch)
+{
+    const size_t record_length = state.range(0);
+    const size_t pattern_length = state.range(1);
+
+    ShortInput input = generate_input(record_length, pattern_length);
+    seqan::StringSet<seqan::CharString> needles, haystacks;
+    for (const auto & record : input.records)
+    {
+        seqan::appendValue(needles, seqan::CharString(input.pattern));
+        seqan::appendValue(haystacks, seqan::CharString(record));
+    }
+
+    seqan::String<int> scores;
+    seqan::String<size_t> ends;
+    seqan::resize(scores, RECORDS);
+    seqan::resize(ends, RECORDS);
+    for (auto _ : state)
+    {
+        if (batch)
+        {
+            seqan::myersBatchScores(scores, ends, needles, haystacks);
+        }
+        else
+        {
+            for (size_t i = 0; i < RECORDS; ++i)
+            {
+                seqan::Pattern<seqan::CharString, seqan::Myers<> > pattern(needles[i]);
+                seqan::Finder<seqan::CharString> finder(haystacks[i]);
+                scores[i] = -static_cast<int>(pattern_length) - 1;
+                while (seqan::find(finder, pattern, -static_cast<int>(pattern_length)))
+                {
+                    if (seqan::getScore(pattern) > scores[i])
+                    {
+                        scores[i] = seqan::getScore(pattern);
+                        ends[i] = seqan::endPosition(finder);
+                    }
+                }
+            }
+        }
+        benchmark::DoNotOptimize(&scores[0]);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORDS);
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+    // the engines are static, the benchmarks keep pointers to them
+    static const std::vector<Engine> engines = all_engines();
+
+    for (const auto & engine : engines)
+    {
+        benchmark::RegisterBenchmark(engine.name, run_short_records, std::cref(engine))
+                ->ArgNames({"record", "pattern", "k"})
+                ->Args({16, 8, 1})
+                ->Args({32, 8, 1})
+                ->Args({32, 16, 2})
+                ->Args({64, 16, 2})
+                ->Args({100, 24, 2})
+                ->Args({128, 24, 3});
+    }
+
+    for (bool batch : {false, true})
+    {
+        benchmark::RegisterBenchmark(batch ? "myers_pairs_batch" : "myers_pairs", run_record_pairs, batch)
+                ->ArgNames({"record", "pattern"})
+                ->Args({32, 16})
+                ->Args({64, 24})
+                ->Args({100, 48})
+                ->Args({128, 64});
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}